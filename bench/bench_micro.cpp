@@ -0,0 +1,205 @@
+#include <benchmark/benchmark.h>
+
+#include "common/ttt.h"
+#include "common/ttt_utils.h"
+#include "common/board.h"
+#include "score.h"
+#include "transposition_table.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#define SAMPLES (1 << 10) // positions, a power of 2
+#define BENCH_TABLE_SIZE (1 << 20)
+
+/// positions of random games (from a fixed seed), with the sub-boards they contain
+struct Samples
+{
+  struct Position
+  {
+    Board board;
+    Move moveGenerator;
+    player_t player;
+    Move move; // a legal move
+  };
+
+  std::vector<Position> positions;
+  std::vector<ttt_t> ttts;
+
+  Samples()
+  {
+    std::mt19937 rng(0);
+    std::array<MoveValued, 9*9+1> moves;
+
+    while (positions.size() < SAMPLES)
+    {
+      Board board;
+      Move moveGenerator = Move::any;
+      player_t player = Owner::Player0;
+      while (board.winner() == Owner::None && positions.size() < SAMPLES)
+      {
+        board.possibleMoves(moves, moveGenerator);
+        int nbMoves = 0;
+        while (moves[nbMoves].move != Move::end)
+          nbMoves++;
+        const Move move = moves[std::uniform_int_distribution<int>(0, nbMoves - 1)(rng)].move;
+
+        positions.push_back({board, moveGenerator, player, move});
+        for (ttt_t ttt : board.getBoard())
+          ttts.push_back(ttt);
+
+        board.action(move, player);
+        moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+        player = OTHER(player);
+      }
+    }
+    ttts.resize(SAMPLES);
+  }
+};
+
+static Samples& samples()
+{
+  static Samples all;
+  return all;
+}
+
+static void BM_win(benchmark::State& state)
+{
+  const auto& ttts = samples().ttts;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(win(ttts[i++ % SAMPLES], Owner::Player0));
+}
+BENCHMARK(BM_win);
+
+static void BM_nones(benchmark::State& state)
+{
+  const auto& ttts = samples().ttts;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(nones(ttts[i++ % SAMPLES]));
+}
+BENCHMARK(BM_nones);
+
+static void BM_winnable(benchmark::State& state)
+{
+  const auto& ttts = samples().ttts;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(winnable(ttts[i++ % SAMPLES], Owner::Player0));
+}
+BENCHMARK(BM_winnable);
+
+static void BM_normalize(benchmark::State& state)
+{
+  const auto& ttts = samples().ttts;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(normalize(ttts[i++ % SAMPLES]));
+}
+BENCHMARK(BM_normalize);
+
+static void BM_scoreBoard(benchmark::State& state)
+{
+  static const Scoring scoring;
+  const auto& positions = samples().positions;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(scoring.score(positions[i++ % SAMPLES].board));
+}
+BENCHMARK(BM_scoreBoard);
+
+/// argument 1 for the positions where any move is possible, 0 for the forced ones
+static void BM_possibleMoves(benchmark::State& state)
+{
+  std::vector<const Samples::Position*> selected;
+  for (const auto& position : samples().positions)
+    if ((position.moveGenerator == Move::any) == (state.range(0) == 1))
+      selected.push_back(&position);
+
+  std::array<MoveValued, 9*9+1> moves;
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    const auto& position = *selected[i++ % selected.size()];
+    position.board.possibleMoves(moves, position.moveGenerator);
+    benchmark::DoNotOptimize(moves.data());
+  }
+}
+BENCHMARK(BM_possibleMoves)->ArgName("any")->Arg(0)->Arg(1);
+
+static void BM_actionCancel(benchmark::State& state)
+{
+  auto& positions = samples().positions;
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    auto& position = positions[i++ % SAMPLES];
+    position.board.action(position.move, position.player);
+    position.board.cancel();
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_actionCancel);
+
+/// random boards and entries, the table is filled to the argument (in %) before the measures
+struct TableSamples
+{
+  std::unique_ptr<TranspositionTable<BENCH_TABLE_SIZE>> table;
+  std::vector<std::array<ttt_t, 9>> boards;
+  std::vector<ExploredPosition> entries;
+
+  TableSamples(int fillPercent) : table(new TranspositionTable<BENCH_TABLE_SIZE>())
+  {
+    std::mt19937_64 rng(fillPercent);
+    const long nbEntries = std::max(SAMPLES, BENCH_TABLE_SIZE / 100 * fillPercent);
+    for (long i = 0; i < nbEntries; i++)
+    {
+      std::array<ttt_t, 9> board;
+      for (ttt_t& ttt : board)
+        ttt = rng() % NUMBER_OF_TTT;
+      boards.push_back(board);
+
+      ExploredPosition pos;
+      pos.type = ExploredPositionType::EXACT;
+      pos.depthBelow = rng() % 16;
+      pos.fullMoves = true;
+      pos.bestMove = rng() % (9*9);
+      pos.player = rng() % 2;
+      pos.value = rng() % 1000;
+      entries.push_back(pos);
+
+      if (i < BENCH_TABLE_SIZE / 100 * fillPercent)
+        table->put(board, entries.back());
+    }
+  }
+};
+
+static void BM_tableGet(benchmark::State& state)
+{
+  TableSamples samples(state.range(0));
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    const size_t k = i++ % samples.boards.size();
+    benchmark::DoNotOptimize(samples.table->get(samples.boards[k], samples.entries[k].player ? Owner::Player0 : Owner::Player1, Move::any));
+  }
+}
+BENCHMARK(BM_tableGet)->ArgName("fill%")->Arg(0)->Arg(50)->Arg(90);
+
+static void BM_tablePut(benchmark::State& state)
+{
+  TableSamples samples(state.range(0));
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    const size_t k = i++ % samples.boards.size();
+    ExploredPosition pos = samples.entries[k];
+    pos.depthBelow = (pos.depthBelow + i) % 16;
+    samples.table->put(samples.boards[k], pos);
+  }
+}
+BENCHMARK(BM_tablePut)->ArgName("fill%")->Arg(0)->Arg(50)->Arg(90);
+
+BENCHMARK_MAIN();
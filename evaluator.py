@@ -136,7 +136,7 @@ def turn(players, player, board, possible_moves, round_number):
 		choice = player['program'].readLine()
 		time_after = datetime.datetime.now()
 
-		player['timebank'] -= (time_after - time_before).microseconds / 1000.
+		player['timebank'] -= (time_after - time_before).total_seconds() * 1000.
 
 		if player['timebank'] < 0:
 				raise GameOver(winner=other(player['id']), reason='Exceeded time limit !')
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "minmax.h"
+#include "common/board.h"
+
+#define ANALYSIS_TABLE_SIZE (1 << 24)
+
+/**
+ * Asynchronous analysis protocol, one command per line:
+ * - position startpos | position field forced player: forced is the index Y*3+X of the sub-board to play in (-1 for any)
+ * - multipv K: number of best root moves reported at each depth
+ * - go depth N | go movetime MS | go infinite: starts a search in its own thread
+ * - stop: aborts the search, which answers with its best move
+ * - isready: answers readyok
+ * - quit
+ *
+ * The search writes "info depth D multipv K score S nodes N nps N time MS pv x,y ..." for each line of
+ * each completed depth, and "bestmove x,y" when it ends. A move x,y is the column and the row of the cell,
+ * a score is from the point of view of the player to move ("win N" or "loss N" when it ends in N moves).
+ */
+class AnalysisSession {
+public:
+    AnalysisSession(const Scoring& scoring, std::ostream& out) : ai(new MinMaxBasedAI<ANALYSIS_TABLE_SIZE>(scoring)), out(out) {
+        ai->setVerbose(false);
+        ai->setStopFlag(&stopFlag);
+        ai->setInfoCallback([this](const SearchResult& line, int multiPvIndex) { info(line, multiPvIndex); });
+    }
+
+    ~AnalysisSession() {
+        stop();
+    }
+
+    void run(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line) && command(line)) {
+        }
+        stop();
+    }
+
+    /// false when the session is over
+    bool command(const std::string& line) {
+        std::stringstream ss(line);
+        std::string op;
+        ss >> op;
+
+        if (op == "position") {
+            stop();
+            std::string field;
+            ss >> field;
+            if (field == "startpos") {
+                board = Board();
+                moveGenerator = Move::any;
+                player = Owner::Player0;
+            }
+            else {
+                int forced;
+                char p;
+                if (!(ss >> forced >> p) || !Board::isValidField(field) || forced < -1 || forced > 8
+                    || (from_char(p) != Owner::Player0 && from_char(p) != Owner::Player1)) {
+                    print("info string invalid position");
+                    return true;
+                }
+                board = Board(field);
+                player = from_char(p);
+                moveGenerator = board.forcingMoveGenerator(forced);
+            }
+        }
+        else if (op == "multipv") {
+            stop();
+            int multiPv = 1;
+            ss >> multiPv;
+            ai->setMultiPv(multiPv);
+        }
+        else if (op == "go") {
+            stop();
+            std::string limit;
+            double value = 0;
+            ss >> limit >> value;
+
+            if (limit == "depth" && value >= MIN_DEPTH)
+                go(std::numeric_limits<double>::infinity(), std::min((int) value, MAX_DEPTH));
+            else if (limit == "movetime" && value > 0)
+                go(value, MAX_DEPTH);
+            else if (limit == "infinite")
+                go(std::numeric_limits<double>::infinity(), MAX_DEPTH);
+            else
+                print("info string invalid go");
+        }
+        else if (op == "stop") {
+            stop();
+        }
+        else if (op == "isready") {
+            print("readyok");
+        }
+        else if (op == "quit") {
+            stop();
+            return false;
+        }
+        else if (!op.empty()) {
+            print("info string unknown command " + op);
+        }
+        return true;
+    }
+
+    /// waits for the end of the current search, if any
+    void wait() {
+        if (searchThread.joinable()) {
+            searchThread.join();
+        }
+    }
+
+private:
+    void go(double timeBudget, int depthLimit) {
+        if (board.isOver()) {
+            print("info string game over");
+            print("bestmove none");
+            return;
+        }
+
+        stopFlag.store(false);
+        searchThread = std::thread([this, timeBudget, depthLimit]() {
+            Board searched = board;
+            const SearchResult result = ai->analyse(searched, player, moveGenerator, timeBudget, depthLimit);
+            print("bestmove " + toString(result.best.move));
+        });
+    }
+
+    void stop() {
+        stopFlag.store(true);
+        wait();
+    }
+
+    void info(const SearchResult& line, int multiPvIndex) {
+        std::stringstream ss;
+        ss << "info depth " << line.depth
+            << " multipv " << multiPvIndex+1
+            << " score " << scoreToString(line.best.value)
+            << " nodes " << line.positions
+            << " nps " << (long) (line.elapsed > 0 ? line.positions / line.elapsed : 0)
+            << " time " << (long) (line.elapsed * 1000)
+            << " pv";
+        for (const Move& move : line.pv) {
+            ss << ' ' << toString(move);
+        }
+        print(ss.str());
+    }
+
+    void print(const std::string& line) {
+        std::lock_guard<std::mutex> lock(outMutex);
+        out << line << std::endl;
+    }
+
+    static std::string toString(const Move& move) {
+        if (move == Move::end || move == Move::skip || move == Move::any) {
+            return "none";
+        }
+        return std::to_string(move.X()*3 + move.x()) + ',' + std::to_string(move.Y()*3 + move.y());
+    }
+
+    static std::string scoreToString(score_t value) {
+        if (isDraw(value)) {
+            return "draw";
+        }
+        if (std::abs(value) >= GLOBAL_VICTORY0_SCORE-MAX_DEPTH) {
+            // victories are GLOBAL_VICTORY0_SCORE minus the number of moves to reach them
+            return std::string(value > 0 ? "win " : "loss ") + std::to_string(GLOBAL_VICTORY0_SCORE - std::abs(value));
+        }
+        return std::to_string(value);
+    }
+
+private:
+    std::unique_ptr<MinMaxBasedAI<ANALYSIS_TABLE_SIZE>> ai;
+
+    Board board;
+    Move moveGenerator = Move::any;
+    player_t player = Owner::Player0;
+
+    std::thread searchThread;
+    std::atomic<bool> stopFlag;
+
+    std::mutex outMutex;
+    std::ostream& out;
+};
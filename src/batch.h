@@ -0,0 +1,177 @@
+#pragma once
+
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "minmax.h"
+#include "common/board.h"
+
+#define BATCH_TABLE_SIZE (1 << 22) // transposition table of each worker
+#define BATCH_QUEUE_SIZE (1024) // records read ahead of the workers
+
+/**
+ * One position to analyse, as a line "field forced player depth N" or "field forced player time MS":
+ * - field: the 81 cells of the riddles protocol
+ * - forced: index Y*3+X of the sub-board to play in, -1 for any
+ * - player: 0 or 1, the player to move
+ */
+struct BatchRecord {
+    long index; /// line number in the input
+    std::string field;
+    int forced;
+    player_t player;
+    int depth; /// depth limit, MAX_DEPTH when limited by time
+    double time; /// time budget in ms, infinite when limited by depth
+
+    /// false when the line is not a valid record
+    bool parse(const std::string& line) {
+        std::stringstream ss(line);
+        char p;
+        std::string limit;
+        double value;
+        if (!(ss >> field >> forced >> p >> limit >> value) || forced < -1 || forced > 8) {
+            return false;
+        }
+
+        if (!Board::isValidField(field)) {
+            return false;
+        }
+
+        player = from_char(p);
+        if (player != Owner::Player0 && player != Owner::Player1) {
+            return false;
+        }
+
+        if (limit == "depth" && value >= MIN_DEPTH) {
+            depth = std::min((int) value, MAX_DEPTH);
+            time = std::numeric_limits<double>::infinity();
+        }
+        else if (limit == "time" && value > 0) {
+            depth = MAX_DEPTH;
+            time = value;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Analyses records on a pool of worker threads, each one with its own MinMaxBasedAI.
+ * Results are written as soon as they are found, so not in the order of the input:
+ * "index move X*3+x Y*3+y score S depth D nodes N time MS", or "index error ..." for invalid records.
+ */
+class BatchAnalyser {
+    using BatchAI = MinMaxBasedAI<BATCH_TABLE_SIZE>;
+
+public:
+    BatchAnalyser(const Scoring& scoring, int nbWorkers) : scoring(scoring), nbWorkers(std::max(1, nbWorkers)) {
+    }
+
+    void run(std::istream& in, std::ostream& out) {
+        finished = false;
+
+        std::vector<std::unique_ptr<BatchAI>> ais;
+        for (int i = 0; i < nbWorkers; i++) {
+            ais.emplace_back(new BatchAI(scoring));
+            ais.back()->setVerbose(false);
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < nbWorkers; i++) {
+            workers.emplace_back(&BatchAnalyser::work, this, std::ref(*ais[i]), std::ref(out));
+        }
+
+        std::string line;
+        long index = 0;
+        while (std::getline(in, line)) {
+            index++;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            BatchRecord record;
+            if (!record.parse(line)) {
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << index << " error invalid record" << std::endl;
+                continue;
+            }
+            record.index = index;
+
+            std::unique_lock<std::mutex> lock(queueMutex);
+            notFull.wait(lock, [&]() { return records.size() < BATCH_QUEUE_SIZE; });
+            records.push(record);
+            notEmpty.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            finished = true;
+        }
+        notEmpty.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+private:
+    void work(BatchAI& ai, std::ostream& out) {
+        BatchRecord record;
+        while (next(record)) {
+            Board board(record.field);
+            const Move moveGenerator = board.forcingMoveGenerator(record.forced);
+
+            std::stringstream result;
+            result << record.index;
+            if (board.isOver()) {
+                result << " error game over";
+            }
+            else {
+                const SearchResult search = ai.analyse(board, record.player, moveGenerator, record.time, record.depth);
+                const Move move = search.best.move;
+                result << " move " << move.X()*3 + move.x() << ' ' << move.Y()*3 + move.y()
+                    << " score " << decodeDraw(search.best.value)
+                    << " depth " << search.depth
+                    << " nodes " << search.positions
+                    << " time " << (long) (search.elapsed * 1000);
+            }
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << result.str() << std::endl;
+        }
+    }
+
+    bool next(BatchRecord& record) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [&]() { return !records.empty() || finished; });
+        if (records.empty()) {
+            return false;
+        }
+
+        record = records.front();
+        records.pop();
+        notFull.notify_one();
+        return true;
+    }
+
+private:
+    const Scoring& scoring;
+    const int nbWorkers;
+
+    std::mutex queueMutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::queue<BatchRecord> records;
+    bool finished;
+
+    std::mutex outMutex;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "minmax.h"
+#include "zobrist.h"
+#include "common/board.h"
+
+#define BENCH_SEED (20240101) // of the hashes, so that node counts are reproducible
+
+/// forced is the index Y*3+X of the sub-board to play in, -1 for any
+struct BenchPosition {
+    const char* name;
+    const char* field;
+    int forced;
+    char player;
+    int depth;
+};
+
+/// the positions of in/*.in, then positions of random games at several stages
+static const std::array<BenchPosition, 11> benchPositions = {{
+    {"begin0", ".,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.", -1, '0', 9},
+    {"begin1", ".,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.", -1, '1', 9},
+    {"draw", "1,0,0,1,0,0,.,1,0,0,1,1,0,1,1,.,1,1,0,1,0,1,.,0,0,1,1,1,1,1,0,0,0,0,0,0,.,.,.,.,1,.,.,.,.,.,.,0,.,.,.,0,.,0,1,1,1,0,.,.,1,1,1,.,.,1,0,.,.,.,.,1,0,1,0,0,.,0,1,1,0", 1, '0', 12},
+    {"lose", "1,.,0,.,1,.,1,0,1,.,.,1,0,1,.,0,0,1,0,.,0,.,1,.,.,0,0,.,0,1,.,0,1,0,0,0,1,1,.,0,0,1,.,.,.,1,1,.,.,0,.,1,0,0,1,.,1,.,0,1,1,.,0,0,.,0,0,1,1,.,1,1,.,.,0,1,0,.,.,.,1", 0, '0', 12},
+    {"win", "1,.,1,0,.,0,.,1,1,0,.,.,0,.,0,0,0,0,.,1,.,1,.,.,.,.,.,.,1,1,0,1,1,.,.,1,0,0,1,1,0,.,.,1,.,1,1,0,.,.,0,.,1,0,.,0,.,.,.,0,0,1,.,0,.,.,.,.,0,1,.,.,.,0,.,.,1,0,1,.,1", -1, '0', 12},
+    {"random12", "1,.,.,.,.,.,.,.,.,.,.,.,.,.,1,.,.,.,.,.,1,.,.,1,1,.,.,.,.,.,.,.,.,0,0,0,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,0,0,.,.,.,1,.,.,.,.,.,.,0,.,.,.,.,.,.,.,.", 0, '0', 9},
+    {"random22", ".,.,.,.,.,.,.,.,1,.,.,.,.,.,0,0,0,.,.,.,.,0,.,.,0,.,.,.,.,1,.,.,.,.,1,.,.,.,.,.,1,.,.,.,.,0,.,.,0,1,.,0,.,1,.,1,1,.,.,.,.,.,0,1,.,0,.,0,.,.,.,.,1,1,.,.,.,.,.,.,.", 7, '0', 10},
+    {"random30", "1,0,.,1,.,.,1,.,.,.,.,0,.,1,1,.,.,.,0,.,1,.,.,1,1,.,.,.,.,.,.,.,.,0,0,0,.,.,.,.,0,0,.,.,.,.,.,.,1,.,0,.,.,.,.,1,0,.,.,.,0,0,.,.,1,1,.,.,.,.,1,.,0,1,.,0,.,.,0,.,1", -1, '0', 10},
+    {"random32", "1,.,0,.,.,0,0,.,.,.,.,1,.,.,.,.,1,.,1,1,.,1,1,.,0,1,.,.,1,1,0,0,.,0,.,.,.,.,.,.,.,.,0,1,.,1,.,0,.,.,.,.,.,.,0,0,.,.,.,.,.,.,1,0,.,1,0,.,0,1,.,.,1,.,0,0,.,.,.,.,.", 6, '0', 10},
+    {"random35", ".,.,1,.,.,.,0,.,1,0,1,.,.,.,0,0,0,.,.,.,.,0,.,.,0,.,.,0,.,1,.,.,.,1,1,0,1,.,1,.,1,0,.,.,.,0,.,.,0,1,.,0,.,1,.,1,1,.,.,.,.,.,0,1,.,0,0,0,.,.,.,.,1,1,.,.,.,0,.,1,.", -1, '1', 10},
+    {"random40", "1,.,0,.,.,0,0,.,.,.,1,1,.,.,.,.,1,.,1,1,1,1,1,.,0,1,.,0,1,1,0,0,.,0,.,.,.,.,.,1,.,.,0,1,.,1,.,0,.,0,.,.,.,.,0,0,.,.,.,.,0,.,1,0,0,1,0,.,0,1,.,.,1,.,0,0,.,1,.,.,.", 8, '0', 11},
+}};
+
+struct BenchResult {
+    long nodes = 0; /// the signature of the search behavior
+    double elapsed = 0; /// in seconds
+};
+
+/**
+ * Searches each bench position to its depth (plus depthOffset) with the same AI, without time limit.
+ * The AI must be built after seedHashers(BENCH_SEED) for the node counts to be reproducible.
+ */
+template<class AI>
+BenchResult runBench(AI& ai, int depthOffset, std::ostream& out) {
+    BenchResult total;
+    for (const BenchPosition& position : benchPositions) {
+        Board board(position.field);
+        const Move moveGenerator = board.forcingMoveGenerator(position.forced);
+        const int depth = std::max(MIN_DEPTH, std::min(position.depth + depthOffset, MAX_DEPTH));
+
+        const SearchResult result = ai.analyse(board, from_char(position.player), moveGenerator, std::numeric_limits<double>::infinity(), depth);
+        total.nodes += result.positions;
+        total.elapsed += result.elapsed;
+
+        out << std::left << std::setw(10) << position.name << std::right
+            << " depth " << std::setw(2) << result.depth
+            << " score " << std::setw(6) << decodeDraw(result.best.value)
+            << " nodes " << std::setw(10) << result.positions << std::endl;
+    }
+    return total;
+}
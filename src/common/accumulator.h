@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "ttt.h"
+
+#define NNUE_FEATURES (2*9*9) // one input per (cell, player) of the normalized board
+#define NNUE_HIDDEN (64) // width of the first layer
+
+/// feature of the cell i of the sub-board index owned by player
+#define NNUE_FEATURE(index, i, player) (2*((index)*9 + (i)) + (player)-1)
+
+/// First layer of the network, quantized so that 1.0 is 127
+struct FeatureWeights {
+	std::array<int16_t, NNUE_HIDDEN> bias;
+	std::array<std::array<int16_t, NNUE_HIDDEN>, NNUE_FEATURES> weights;
+};
+
+/**
+ * First layer outputs of the positions of a Board, from the position it was attached to
+ * up to the current one. As a move only changes one sub-board, push() only applies the
+ * weights of the cells that changed instead of recomputing the whole layer.
+ */
+class Accumulator {
+public:
+	using Values = std::array<int16_t, NNUE_HIDDEN>;
+
+	void use(const FeatureWeights& features) {
+		weights = &features;
+	}
+
+	void refresh(const std::array<ttt_t, 9>& board) {
+		top = 0;
+		auto& values = stack[top];
+		values = weights->bias;
+
+		for (int index = 0; index < 9; index++)
+		for (int i = 0; i < 9; i++) {
+			const auto c = get_ttt_int(board[index], i);
+			if (c != Owner::None) {
+				add(values, NNUE_FEATURE(index, i, c));
+			}
+		}
+	}
+
+	/// the sub-board index went from before to after
+	inline void push(int index, ttt_t before, ttt_t after) {
+		stack[top+1] = stack[top];
+		top++;
+
+		auto& values = stack[top];
+		for (int i = 0; i < 9; i++) {
+			const auto b = get_ttt_int(before, i);
+			const auto a = get_ttt_int(after, i);
+			if (a == b) continue;
+
+			if (b != Owner::None) sub(values, NNUE_FEATURE(index, i, b));
+			if (a != Owner::None) add(values, NNUE_FEATURE(index, i, a));
+		}
+	}
+
+	inline void pop() {
+		top--;
+	}
+
+	inline const Values& current() const {
+		return stack[top];
+	}
+
+private:
+	inline void add(Values& values, int feature) const {
+		const auto& w = weights->weights[feature];
+		for (int h = 0; h < NNUE_HIDDEN; h++) values[h] += w[h];
+	}
+
+	inline void sub(Values& values, int feature) const {
+		const auto& w = weights->weights[feature];
+		for (int h = 0; h < NNUE_HIDDEN; h++) values[h] -= w[h];
+	}
+
+private:
+	const FeatureWeights* weights = nullptr;
+
+	int top = 0;
+	std::array<Values, 9*9+1> stack;
+};
@@ -11,6 +11,7 @@
 #include "move.h"
 #include "ttt.h"
 #include "ttt_utils.h"
+#include "accumulator.h"
 
 #define AT_9(s, y, x) (s[y*3 + x])
 #define AT_9m(s, m) (s[((Move) m).j/9])
@@ -62,10 +63,21 @@ public:
 			state.winner = Owner::Player0;
 		if (win(state.macro_board, Owner::Player1))
 			state.winner = Owner::Player1;
-		if (state.nones_sum == 0)
+		if (state.nones_sum == 0 || (state.winner == Owner::None && !macroWinnable()))
 			state.winner = Owner::Draw;
 	}
 
+	/// the 81 cells of the riddles protocol ('.', '0' or '1', commas are ignored)
+	static bool isValidField(const std::string& in) {
+		int cells = 0;
+		for (char c : in) {
+			if (c == ',') continue;
+			if (c != '.' && c != '0' && c != '1') return false;
+			cells++;
+		}
+		return cells == 9*9;
+	}
+
 	inline ttt_t get(const Move& move) const {
 		return get_ttt_int(AT_9m(state.board, move), move.j%9);
 	}
@@ -90,9 +102,24 @@ public:
 		return win(AT_9m(state.board, m), Owner::Player0) || win(AT_9m(state.board, m), Owner::Player1) || nones(AT_9m(state.board, m)) == 0;
 	}
 
+	/// generator of the moves in sub-board subBoard (a previous move, only its cell matters),
+	/// Move::any when subBoard is -1 or the sub-board is won or full
+	inline Move forcingMoveGenerator(int subBoard) const {
+		return (subBoard >= 0 && !isWonOrFull_d(subBoard)) ? Move(0, 0, subBoard/3, subBoard%3) : Move::any;
+	}
+
+	inline void possibleMoves(std::array<MoveValued, 9*9+1>& moves, const Move& moveGenerator) const {
+		if (moveGenerator != Move::any)
+			possibleMoves<false>(moves, moveGenerator);
+		else
+			possibleMoves<true>(moves, moveGenerator);
+	}
+
+	/// Free must be (moveGenerator == Move::any)
+	template<bool Free>
 	inline void possibleMoves(std::array<MoveValued, 9*9+1>& moves, const Move& moveGenerator) const {
 		int cnt = 0;
-		if (moveGenerator != Move::any) {
+		if (!Free) {
 			uint8_t mov = moveGenerator.j%9;
 
 			for (uint8_t m = 0; m < 9; m++) {
@@ -119,21 +146,32 @@ public:
 				&& !isWonOrFull(move) && get(move) == Owner::None;
 	}
 
+	/// Owner::Draw as soon as no macro line can be completed anymore, even with moves left (see isOver())
 	inline player_t winner() const {
 		return state.winner;
 	}
 
+	/// won, or no move left: the game goes on after an early draw, its moves can't change the result
+	inline bool isOver() const {
+		return (state.winner != Owner::None && state.winner != Owner::Draw) || state.nones_sum == 0;
+	}
+
+	POPCNT_CLONES
 	void action(const Move& move, player_t player) {
 		// save informations
 		actions[actions_size++] = state;
 
 		// actions here
 		auto& ttt = AT_9m(state.board, move);
+		const auto before = ttt;
 		set_ttt_int(ttt, move.j%9, player);
 		const auto nones_to_remove = nones(ttt);
 
 		ttt = normalize(ttt);
 
+		if (accumulator != nullptr)
+			accumulator->push(move.j/9, before, ttt);
+
 		state.nones_sum--; // one none was removed of the ttt
 
 		// macro board update if necessary
@@ -153,18 +191,38 @@ public:
 			state.winner = Owner::Player0;
 		else if (win(state.macro_board, Owner::Player1))
 			state.winner = Owner::Player1;
-		else if (state.nones_sum == 0)
+		else if (state.nones_sum == 0 || !macroWinnable())
 			state.winner = Owner::Draw;
 	}
 
 	void cancel() {
 		state = actions[--actions_size];
+
+		if (accumulator != nullptr)
+			accumulator->pop();
+	}
+
+	/// the accumulator follows the next actions and cancels, copies of the board share it
+	void attach(Accumulator* accumulator) {
+		this->accumulator = accumulator;
+
+		if (accumulator != nullptr)
+			accumulator->refresh(state.board);
+	}
+
+	inline const Accumulator* getAccumulator() const {
+		return accumulator;
 	}
 
 	inline int actionsSize() const {
 		return actions_size;
 	}
 
+	/// free cells of the sub-boards still open
+	inline int nonesSum() const {
+		return state.nones_sum;
+	}
+
 	const std::array<ttt_t, 9>& getBoard() const {
 		return state.board;
 	}
@@ -172,6 +230,20 @@ public:
 	friend std::ostream& operator<<(std::ostream& os, const Board& that);
 
 private:
+	/// a player can still complete a macro line, the sub-boards they can't win anymore are the opponent's
+	bool macroWinnable() const {
+		for (player_t player : {Owner::Player0, Owner::Player1}) {
+			auto reach = state.macro_board;
+			for (int i = 0; i < 9; i++) {
+				if (get_ttt_int(reach, i) == Owner::None && !winnable(state.board[i], static_cast<Owner>(player)))
+					set_ttt_int(reach, i, OTHER(player));
+			}
+			if (winnable(reach, static_cast<Owner>(player)))
+				return true;
+		}
+		return false;
+	}
+
 	int macroBoardFromBoard() const {
 		auto macro_board = EMPTY_TTT;
 
@@ -197,6 +269,8 @@ private:
 
 	int actions_size = 0;
 	std::array<State, 9*9> actions;
+
+	Accumulator* accumulator = nullptr;
 };
 
 std::ostream& operator<<(std::ostream& os, const Board& that) {
@@ -3,9 +3,18 @@
 #include <array>
 #include <tuple>
 #include <cmath>
+#include <iostream>
 
 #include "types.h"
 
+// functions that count bits are also compiled with the popcnt instruction, picked at startup when the CPU has it
+// (unless the whole build already uses it)
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__POPCNT__)
+#define POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define POPCNT_CLONES
+#endif
+
 enum Owner : player_t
 {
   None    = 0, // 0b00
@@ -0,0 +1,13 @@
+#include <iostream>
+
+#include "analysis.h"
+
+int main() {
+	std::ios::sync_with_stdio(false);
+
+	const Scoring scoring;
+	AnalysisSession session(scoring, std::cout);
+	session.run(std::cin);
+
+	return 0;
+}
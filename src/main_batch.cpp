@@ -0,0 +1,49 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "batch.h"
+
+void usage() {
+	std::cerr << "usage: main_batch [-j workers] [records file]" << std::endl
+		<< "  records (one per line, from the standard input without file):" << std::endl
+		<< "  field forced-sub-board(-1 for any) player(0|1) depth N | time MS" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	int nbWorkers = std::thread::hardware_concurrency();
+	const char* path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-j") == 0 && i+1 < argc)
+			nbWorkers = std::atoi(argv[++i]);
+		else if (path == nullptr && argv[i][0] != '-')
+			path = argv[i];
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	const Scoring scoring;
+	BatchAnalyser analyser(scoring, nbWorkers);
+
+	if (path == nullptr) {
+		analyser.run(std::cin, std::cout);
+		return 0;
+	}
+
+	std::ifstream in(path);
+	if (!in) {
+		std::cerr << "cannot open " << path << std::endl;
+		return 1;
+	}
+	analyser.run(in, std::cout);
+	return 0;
+}
@@ -3,6 +3,9 @@
 #include <sstream>
 #include <string>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
 
 #include "mcts.h"
 #include "common/board.h"
@@ -28,15 +31,26 @@ double computeTimeBudget(double availableTimeInMs) {
 	return (availableTimeInMs > SAFE_TIME) ? BUDGET_TIME : FAILSAFE_TIME;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
 	std::ios::sync_with_stdio(false);
 
 	Board board;
-	int myBot = Owner::Player0;
+	player_t myPlayer = Owner::Player0;
 
 	Move givenMoveGenerator;
 
-	MCTSBasedAI ai;
+	// number of threads searching the tree, defaults to all cores
+	const int nbThreads = (argc > 1) ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+	const float raveEquivalence = (argc > 2) ? std::atof(argv[2]) : RAVE_EQUIVALENCE;
+
+	MCTSBasedAI ai(nbThreads, true, raveEquivalence);
+
+	// MCTS-minimax hybrid, enabled by a non zero third argument
+	std::unique_ptr<Scoring> scoring;
+	if (argc > 3 && std::atoi(argv[3]) != 0) {
+		scoring.reset(new Scoring());
+		ai.enableHybrid(*scoring);
+	}
 
 	while (true) {
 		std::string line;
@@ -52,7 +66,7 @@ int main() {
 			if (your_botid == "your_botid") {
 				char c;
 				ss >> c;
-				myBot = from_char(c);
+				myPlayer = from_char(c);
 			}
 			continue;
 		}
@@ -100,8 +114,7 @@ int main() {
 			int availableTimeInMs;
 			ss >> availableTimeInMs;
 
-            const auto myTurn = (myBot == Owner::Player0) ? true : false;
-			const auto bestMove = ai.play(board, myTurn, givenMoveGenerator, computeTimeBudget(availableTimeInMs));
+			const auto bestMove = ai.play(board, myPlayer, givenMoveGenerator, computeTimeBudget(availableTimeInMs));
 
 			outputMove(bestMove);
 		}
@@ -5,112 +5,109 @@
 #include <chrono>
 
 #include "minmax.h"
+#include "nnue.h"
+#include "bench.h"
+#include "riddles.h"
 #include "common/board.h"
 
 // Constants and types ////////////////////////////////////////
 
-#define BUDGET_TIME (450) // ms
-#define FAILSAFE_TIME (100) // ms
-#define SAFE_TIME (2*(BUDGET_TIME)) // ms
-
 #define TABLE_SIZE (1 << 24)
 
-void outputMove(const Move& move) {
-	if (move == Move::end || move == Move::skip) {
-		std::cout << "no_moves" << std::endl;
-	}
-	else {
-		std::cout << "place_move "
-			 << move.X()*3 + move.x() << ' '
-			 << move.Y()*3 + move.y() << std::endl;
+template<class AI>
+int run(AI& ai) {
+	RiddlesGame game;
+
+	while (true) {
+		std::string line;
+		std::getline(std::cin, line);
+
+		int availableTimeInMs;
+		const RiddlesGame::Command command = game.update(line, availableTimeInMs);
+		if (command == RiddlesGame::ACTION) {
+			const auto bestMove = ai.play(game.board, game.myPlayer, game.moveGenerator, computeTimeBudget(availableTimeInMs));
+
+			std::cout << formatMove(bestMove) << std::endl;
+		}
+		else if (command == RiddlesGame::END)
+			break;
 	}
-}
 
-double computeTimeBudget(double availableTimeInMs) {
-	return (availableTimeInMs > SAFE_TIME) ? BUDGET_TIME : FAILSAFE_TIME;
+	return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
 	std::ios::sync_with_stdio(false);
 
-	player_t myPlayer = Owner::Player0;
+	// fixed depth searches of built-in positions with reproducible hashes, their node count is a signature of the search
+	if (argc > 1 && std::string(argv[1]) == "bench") {
+		const int depthOffset = (argc > 2) ? std::atoi(argv[2]) : 0;
+		seedHashers(BENCH_SEED);
+		const Scoring scoring;
+		MinMaxBasedAI<TABLE_SIZE> ai(scoring);
+		ai.setVerbose(false);
+
+		const BenchResult result = runBench(ai, depthOffset, std::cerr);
+		std::cout << "nodes " << result.nodes << std::endl;
+		std::cerr << std::fixed << std::setprecision(3)
+			<< "elapsed: " << result.elapsed << " s, nodes/s: " << (long) (result.nodes / result.elapsed) << std::endl;
+		return 0;
+	}
 
-	Move givenMoveGenerator;
+	// options: --params file (tuned parameters of the hand-crafted scoring, written by main_tuner),
+	// --probcut file (forward pruning margins, written by main_probcut),
+	// --telemetry none|stderr|file (a JSON line per depth and per move), and a network weights file
+	// replacing the hand-crafted scoring
+	std::string paramsPath;
+	std::string probCutPath;
+	std::string networkPath;
+	std::string telemetryTarget = "none";
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--params" && i+1 < argc)
+			paramsPath = argv[++i];
+		else if (std::string(argv[i]) == "--probcut" && i+1 < argc)
+			probCutPath = argv[++i];
+		else if (std::string(argv[i]) == "--telemetry" && i+1 < argc)
+			telemetryTarget = argv[++i];
+		else
+			networkPath = argv[i];
+	}
 
-	const Scoring scoring;
-	MinMaxBasedAI<TABLE_SIZE> ai(scoring);
+	TelemetrySink telemetry;
+	if (!telemetry.open(telemetryTarget)) {
+		std::cerr << "cannot open telemetry file " << telemetryTarget << std::endl;
+		return 1;
+	}
 
-	Board board;
+	ProbCutParameters probCut;
+	if (!probCutPath.empty() && !probCut.load(probCutPath)) {
+		std::cerr << "cannot load ProbCut parameters from " << probCutPath << std::endl;
+		return 1;
+	}
 
-	while (true) {
-		std::string line;
-		std::getline(std::cin, line);
-		std::stringstream ss;
-		ss << line;
-
-		std::string op;
-		ss >> op;
-		if (op[0] == 's') {
-			std::string your_botid;
-			ss >> your_botid;
-			if (your_botid == "your_botid") {
-				char c;
-				ss >> c;
-				myPlayer = from_char(c);
-			}
-			continue;
-		}
-		else if (op[0] == 'u') {
-			std::string game;
-			ss >> game;
-
-			std::string op;
-			ss >> op;
-
-			if (game == "game" && op[0] == 'f') {
-				std::string new_board;
-				ss >> new_board;
-
-				board = Board(new_board);
-			}
-			else if (game == "game" && op[0] == 'm') {
-				givenMoveGenerator = Move::any;
-
-				for (int Y = 0; Y < 3; Y++)
-				for (int X = 0; X < 3; X++)
-				{
-					std::string num;
-					std::getline(ss, num, ',');
-
-					if (num.find("-1") != std::string::npos) {
-						if (givenMoveGenerator == Move::any) {
-							givenMoveGenerator = Move(0, 0, Y, X);
-						}
-						else {
-							givenMoveGenerator = Move::any;
-							goto possibleMovesFound;
-						}
-					}
-				}
-			}
-
-			possibleMovesFound:;
-			continue;
+	if (!networkPath.empty()) {
+		NnueNetwork network;
+		if (!network.load(networkPath)) {
+			std::cerr << "cannot load network weights from " << networkPath << std::endl;
+			return 1;
 		}
-		else if (op[0] == 'a') {
-			std::string move;
-			ss >> move;
 
-			int availableTimeInMs;
-			ss >> availableTimeInMs;
-
-			const auto bestMove = ai.play(board, myPlayer, givenMoveGenerator, computeTimeBudget(availableTimeInMs));
+		const NnueScoring scoring(network);
+		MinMaxBasedAI<TABLE_SIZE, NnueScoring> ai(scoring);
+		ai.setTelemetry(&telemetry);
+		ai.setProbCut(probCut);
+		return run(ai);
+	}
 
-			outputMove(bestMove);
-		}
-		else if (op[0] == 'e')
-			break;
+	ScoringParameters parameters;
+	if (!paramsPath.empty() && !parameters.load(paramsPath)) {
+		std::cerr << "cannot load scoring parameters from " << paramsPath << std::endl;
+		return 1;
 	}
 
-	return 0;
+	const Scoring scoring(parameters);
+	MinMaxBasedAI<TABLE_SIZE> ai(scoring);
+	ai.setTelemetry(&telemetry);
+	ai.setProbCut(probCut);
+	return run(ai);
 }
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "perft.h"
+#include "common/board.h"
+
+void usage() {
+	std::cerr << "usage: main_perft depth [-t threads] [--field field] [--forced sub-board] [--player 0|1]"
+		<< " [--no-bulk] [--no-cache] [--divide]" << std::endl
+		<< "  field: 81 cells as in the riddles protocol (empty board by default)" << std::endl
+		<< "  sub-board: index Y*3+X of the sub-board to play in (any by default)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	const int depth = std::atoi(argv[1]);
+	int nbThreads = std::thread::hardware_concurrency();
+	Board board;
+	int forced = -1;
+	player_t player = Owner::Player0;
+	bool bulk = true;
+	bool cache = true;
+	bool divide = false;
+
+	for (int i = 2; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+			nbThreads = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--field") == 0 && hasValue)
+			board = Board(argv[++i]);
+		else if (std::strcmp(argv[i], "--forced") == 0 && hasValue)
+			forced = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--player") == 0 && hasValue)
+			player = from_char(argv[++i][0]);
+		else if (std::strcmp(argv[i], "--no-bulk") == 0)
+			bulk = false;
+		else if (std::strcmp(argv[i], "--no-cache") == 0)
+			cache = false;
+		else if (std::strcmp(argv[i], "--divide") == 0)
+			divide = true;
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (depth < 0 || depth > PERFT_MAX_DEPTH || (player != Owner::Player0 && player != Owner::Player1)
+		|| forced < -1 || forced > 8 || (forced >= 0 && board.isWonOrFull_d(forced))) {
+		usage();
+		return 1;
+	}
+
+	const Move moveGenerator = board.forcingMoveGenerator(forced);
+
+	Perft perft(bulk, cache ? PERFT_CACHE_SIZE : 0);
+	std::array<uint64_t, 9*9> leavesPerMove;
+
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t leaves = perft.run(board, moveGenerator, player, depth, nbThreads, leavesPerMove);
+	const auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (divide) {
+		for (int j = 0; j < 9*9; j++) {
+			const Move move(j);
+			if (leavesPerMove[j] != 0)
+				std::cout << move.Y() << ' ' << move.X() << ' ' << move.y() << ' ' << move.x() << ": " << leavesPerMove[j] << std::endl;
+		}
+	}
+
+	std::cout << "perft " << depth << ": " << leaves << std::endl;
+	std::cerr << std::fixed << std::setprecision(3)
+		<< "elapsed: " << dt << " s, threads: " << nbThreads
+		<< ", leaves/s: " << leaves/dt
+		<< ", actions: " << perft.actionsCount() << ", actions/s: " << perft.actionsCount()/dt << std::endl;
+
+	return 0;
+}
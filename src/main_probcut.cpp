@@ -0,0 +1,127 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "minmax.h"
+#include "bench.h"
+#include "selfplay.h"
+#include "probcut.h"
+
+#define CALIBRATION_TABLE_SIZE (1 << 20)
+#define MIN_CALIBRATION_PAIRS (100)
+
+void usage() {
+	std::cerr << "usage: main_probcut parameters-file [--games records-file] [--positions N] [--depth D] [--threshold T]" << std::endl
+		<< "  fits the deep scores (depth D, " << PROBCUT_MIN_DEPTH << " by default) on the shallow ones (depth D-" << PROBCUT_REDUCTION << ")" << std::endl
+		<< "  of the bench positions (the ones of in/) and of the positions of self-play games (main_selfplay)," << std::endl
+		<< "  at most N of them (2000 by default), outside of the endgame where ProbCut is off" << std::endl
+		<< "  parameters-file: read by main_minmax --probcut" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	if (argc < 2 || argv[1][0] == '-') {
+		usage();
+		return 1;
+	}
+
+	std::string gamesPath;
+	long maxPositions = 2000;
+	int depth = PROBCUT_MIN_DEPTH;
+	ProbCutParameters parameters;
+
+	for (int i = 2; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			gamesPath = argv[++i];
+		else if (std::strcmp(argv[i], "--positions") == 0 && hasValue)
+			maxPositions = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--depth") == 0 && hasValue)
+			depth = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+			parameters.threshold = std::atof(argv[++i]);
+		else {
+			usage();
+			return 1;
+		}
+	}
+	if (depth - PROBCUT_REDUCTION < MIN_DEPTH || depth > MAX_DEPTH) {
+		std::cerr << "the depth must be between " << MIN_DEPTH + PROBCUT_REDUCTION << " and " << MAX_DEPTH << std::endl;
+		return 1;
+	}
+
+	const Scoring scoring;
+	std::unique_ptr<MinMaxBasedAI<CALIBRATION_TABLE_SIZE>> ai(new MinMaxBasedAI<CALIBRATION_TABLE_SIZE>(scoring));
+	ai->setVerbose(false);
+
+	ProbCutCalibration calibration;
+	long nbPositions = 0;
+	auto addPosition = [&](Board& board, player_t player, const Move& moveGenerator) {
+		if (board.winner() != Owner::None || board.nonesSum() < PROBCUT_MIN_NONES || nbPositions >= maxPositions)
+			return;
+		nbPositions++;
+
+		// the entries left by the previous positions would bias the scores of this one
+		ai->clearTable();
+		const score_t shallow = ai->search(board, player, moveGenerator, depth - PROBCUT_REDUCTION).value;
+		const score_t deep = ai->search(board, player, moveGenerator, depth).value;
+		if (!isDraw(shallow) && !isDraw(deep) && std::abs(shallow) <= PROBCUT_MAX_BOUND && std::abs(deep) <= PROBCUT_MAX_BOUND)
+			calibration.add(shallow, deep);
+	};
+
+	for (const BenchPosition& position : benchPositions) {
+		Board board(position.field);
+		const Move moveGenerator = board.forcingMoveGenerator(position.forced);
+		addPosition(board, from_char(position.player), moveGenerator);
+	}
+
+	if (!gamesPath.empty()) {
+		std::ifstream in(gamesPath, std::ios::binary);
+		GameRecordReader reader(in);
+		if (!reader.isValid()) {
+			std::cerr << "cannot read game records from " << gamesPath << std::endl;
+			return 1;
+		}
+
+		GameRecord record;
+		while (nbPositions < maxPositions && reader.next(record)) {
+			Board board;
+			Move moveGenerator = Move::any;
+			player_t player = Owner::Player0;
+			for (int i = 0; i < record.nbMoves; i++) {
+				if (i >= record.nbRandom)
+					addPosition(board, player, moveGenerator);
+
+				const Move move = record.move(i);
+				board.action(move, player);
+				moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+				player = OTHER(player);
+			}
+		}
+	}
+
+	std::cerr << "positions: " << nbPositions << ", pairs: " << calibration.size() << std::endl;
+	if (calibration.size() < MIN_CALIBRATION_PAIRS) {
+		std::cerr << "too few pairs, add self-play games with --games" << std::endl;
+		return 1;
+	}
+	if (!calibration.fit(parameters)) {
+		std::cerr << "the deep scores don't grow with the shallow ones" << std::endl;
+		return 1;
+	}
+
+	std::cerr << std::fixed << std::setprecision(3)
+		<< "deep = " << parameters.slope << " * shallow + " << parameters.intercept << ", sigma: " << parameters.sigma << std::endl;
+	if (!parameters.save(argv[1])) {
+		std::cerr << "cannot write " << argv[1] << std::endl;
+		return 1;
+	}
+	return 0;
+}
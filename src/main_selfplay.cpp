@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "selfplay.h"
+
+void usage() {
+	std::cerr << "usage: main_selfplay output-file [-j workers] [-n games] [--depth N] [--nodes N] [--random plies] [--seed S]" << std::endl
+		<< "       main_selfplay --dump records-file" << std::endl
+		<< "       main_selfplay --count records-file" << std::endl
+		<< "  --dump writes a line \"field winner score\" per searched position (score of Player0), the input of train_nnue.py" << std::endl
+		<< "  --count reads the records and prints their number and the reading speed" << std::endl;
+}
+
+int read(const char* path, bool dump) {
+	std::ifstream in(path, std::ios::binary);
+	GameRecordReader reader(in);
+	if (!reader.isValid()) {
+		std::cerr << "cannot read game records from " << path << std::endl;
+		return 1;
+	}
+
+	long nbGames = 0;
+	long nbPositions = 0;
+	long nbBytes = 0;
+	const auto start = std::chrono::steady_clock::now();
+
+	GameRecord record;
+	while (reader.next(record)) {
+		nbGames++;
+		nbPositions += record.nbMoves - record.nbRandom;
+		nbBytes += record.size();
+
+		if (dump) {
+			const char winner = to_char(record.winner);
+			forEachPosition(record, [winner](const std::array<char, 9*9>& field, player_t player, score_t score) {
+				for (int i = 0; i < 9*9; i++) {
+					if (i != 0)
+						std::cout << ',';
+					std::cout << field[i];
+				}
+				const int value = decodeDraw(score);
+				std::cout << ' ' << winner << ' ' << ((player == Owner::Player0) ? value : -value) << '\n';
+			});
+		}
+	}
+
+	if (!reader.isValid()) {
+		std::cerr << "corrupted record after " << nbGames << " games" << std::endl;
+		return 1;
+	}
+
+	const auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << std::fixed << std::setprecision(3)
+		<< "games: " << nbGames << ", positions: " << nbPositions << ", bytes: " << nbBytes
+		<< ", elapsed: " << dt << " s, MB/s: " << nbBytes / dt / 1e6 << std::endl;
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	if (argc == 3 && (std::strcmp(argv[1], "--dump") == 0 || std::strcmp(argv[1], "--count") == 0)) {
+		return read(argv[2], std::strcmp(argv[1], "--dump") == 0);
+	}
+	if (argc < 2 || argv[1][0] == '-') {
+		usage();
+		return 1;
+	}
+
+	SelfplaySettings settings;
+	for (int i = 2; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+			settings.nbWorkers = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-n") == 0 && hasValue)
+			settings.nbGames = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--depth") == 0 && hasValue)
+			settings.depth = std::min(std::atoi(argv[++i]), MAX_DEPTH);
+		else if (std::strcmp(argv[i], "--nodes") == 0 && hasValue)
+			settings.positions = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--random") == 0 && hasValue)
+			settings.randomPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			settings.seed = std::strtoull(argv[++i], nullptr, 10);
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (settings.depth < MIN_DEPTH || settings.randomPlies < 0 || settings.positions < 0) {
+		usage();
+		return 1;
+	}
+
+	std::ofstream out(argv[1], std::ios::binary);
+	if (!out) {
+		std::cerr << "cannot open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	const Scoring scoring;
+	Selfplay selfplay(scoring, settings);
+	GameRecordWriter writer(out);
+
+	const auto start = std::chrono::steady_clock::now();
+	const long nbPositions = selfplay.run(writer);
+	const auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << std::fixed << std::setprecision(3)
+		<< "games: " << settings.nbGames << ", positions: " << nbPositions
+		<< ", elapsed: " << dt << " s, games/s: " << settings.nbGames / dt << std::endl;
+	return 0;
+}
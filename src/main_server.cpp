@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "server.h"
+
+void usage() {
+	std::cerr << "usage: main_server [-j threads] [--memory MB] [--games N] [--params file]" << std::endl
+		<< "  hosts up to N games (64 by default) of the riddles.io protocol, each line of the standard input" << std::endl
+		<< "  and of the output starts with the id of its game: ID settings your_botid 0, ID action move 10000, ID end..." << std::endl
+		<< "  the transposition tables of the games share MB megabytes (1024 by default)" << std::endl
+		<< "  --params: tuned parameters of the scoring (written by main_tuner)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	int nbThreads = std::thread::hardware_concurrency();
+	long memoryInMb = 1024;
+	int maxGames = 64;
+	std::string paramsPath;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+			nbThreads = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--memory") == 0 && hasValue)
+			memoryInMb = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			maxGames = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--params") == 0 && hasValue)
+			paramsPath = argv[++i];
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	ScoringParameters parameters;
+	if (!paramsPath.empty() && !parameters.load(paramsPath)) {
+		std::cerr << "cannot load scoring parameters from " << paramsPath << std::endl;
+		return 1;
+	}
+
+	const Scoring scoring(parameters);
+	GameServer server(scoring, nbThreads, memoryInMb << 20, maxGames);
+	std::cerr << "games: " << maxGames << ", table entries per game: " << server.getTableSize() << ", threads: " << nbThreads << std::endl;
+
+	server.run(std::cin, std::cout);
+	return 0;
+}
@@ -0,0 +1,154 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "tournament.h"
+#include "nnue.h"
+
+void usage() {
+	std::cerr << "usage: main_tournament engine engine [-j workers] [-n games] [--time MS] [--nodes N] [--depth N]"
+		<< " [--opening plies] [--seed S] [--sprt elo0 elo1] [--alpha A] [--beta B]" << std::endl
+		<< "  engine: minmax | params=scoring-parameters-file | probcut=probcut-parameters-file | nnue=weights-file | mcts | hybrid | random" << std::endl
+		<< "  the limits apply to each move of both engines (depth to minmax only, nodes are MCTS playouts)" << std::endl
+		<< "  results and Elo are the ones of the first engine" << std::endl;
+}
+
+/// builds the players of an engine, false for an unknown engine
+bool factory(const std::string& engine, const Scoring& scoring, std::vector<std::unique_ptr<Scoring>>& tunedScorings,
+		std::vector<std::unique_ptr<NnueNetwork>>& networks, std::vector<std::unique_ptr<NnueScoring>>& nnueScorings,
+		Tournament::Factory& result) {
+	if (engine == "minmax") {
+		result = [&scoring]() { return std::unique_ptr<TournamentPlayer>(new MinMaxPlayer<>(scoring)); };
+	}
+	else if (engine.compare(0, 7, "params=") == 0) {
+		ScoringParameters parameters;
+		if (!parameters.load(engine.substr(7))) {
+			std::cerr << "cannot load scoring parameters from " << engine.substr(7) << std::endl;
+			return false;
+		}
+		tunedScorings.emplace_back(new Scoring(parameters));
+		const Scoring& tunedScoring = *tunedScorings.back();
+		result = [&tunedScoring]() { return std::unique_ptr<TournamentPlayer>(new MinMaxPlayer<>(tunedScoring)); };
+	}
+	else if (engine.compare(0, 8, "probcut=") == 0) {
+		ProbCutParameters probCut;
+		if (!probCut.load(engine.substr(8))) {
+			std::cerr << "cannot load ProbCut parameters from " << engine.substr(8) << std::endl;
+			return false;
+		}
+		result = [&scoring, probCut]() { return std::unique_ptr<TournamentPlayer>(new MinMaxPlayer<>(scoring, probCut)); };
+	}
+	else if (engine.compare(0, 5, "nnue=") == 0) {
+		networks.emplace_back(new NnueNetwork());
+		if (!networks.back()->load(engine.substr(5))) {
+			std::cerr << "cannot load network weights from " << engine.substr(5) << std::endl;
+			return false;
+		}
+		nnueScorings.emplace_back(new NnueScoring(*networks.back()));
+		const NnueScoring& nnueScoring = *nnueScorings.back();
+		result = [&nnueScoring]() { return std::unique_ptr<TournamentPlayer>(new MinMaxPlayer<NnueScoring>(nnueScoring)); };
+	}
+	else if (engine == "mcts") {
+		result = []() { return std::unique_ptr<TournamentPlayer>(new MCTSPlayer()); };
+	}
+	else if (engine == "hybrid") {
+		result = [&scoring]() { return std::unique_ptr<TournamentPlayer>(new MCTSPlayer(&scoring)); };
+	}
+	else if (engine == "random") {
+		result = []() { return std::unique_ptr<TournamentPlayer>(new RandomPlayer()); };
+	}
+	else {
+		std::cerr << "unknown engine " << engine << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	if (argc < 3) {
+		usage();
+		return 1;
+	}
+
+	TournamentSettings settings;
+	for (int i = 3; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+			settings.nbWorkers = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-n") == 0 && hasValue)
+			settings.maxGames = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--time") == 0 && hasValue)
+			settings.limits.time = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--nodes") == 0 && hasValue)
+			settings.limits.nodes = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--depth") == 0 && hasValue)
+			settings.limits.depth = std::min(std::atoi(argv[++i]), MAX_DEPTH);
+		else if (std::strcmp(argv[i], "--opening") == 0 && hasValue)
+			settings.openingPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			settings.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--sprt") == 0 && i+2 < argc) {
+			settings.sprt = true;
+			settings.elo0 = std::atof(argv[++i]);
+			settings.elo1 = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--alpha") == 0 && hasValue)
+			settings.alpha = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--beta") == 0 && hasValue)
+			settings.beta = std::atof(argv[++i]);
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (settings.limits.depth < MIN_DEPTH || settings.maxGames <= 0 || settings.openingPlies < 0
+		|| settings.alpha <= 0 || settings.beta <= 0 || (settings.sprt && settings.elo1 <= settings.elo0)) {
+		usage();
+		return 1;
+	}
+
+	// without any limit, 100 ms per move
+	if (settings.limits.time == std::numeric_limits<double>::infinity() && settings.limits.nodes == 0 && settings.limits.depth == MAX_DEPTH) {
+		settings.limits.time = 100;
+	}
+	// the MCTS engines need a time or nodes limit to end their moves
+	const bool unlimited = settings.limits.time == std::numeric_limits<double>::infinity() && settings.limits.nodes == 0;
+
+	const Scoring scoring;
+	std::vector<std::unique_ptr<Scoring>> tunedScorings;
+	std::vector<std::unique_ptr<NnueNetwork>> networks;
+	std::vector<std::unique_ptr<NnueScoring>> nnueScorings;
+	Tournament::Factory engines[2];
+	for (int i = 0; i < 2; i++) {
+		const std::string engine = argv[i+1];
+		if (!factory(engine, scoring, tunedScorings, networks, nnueScorings, engines[i]))
+			return 1;
+		if (unlimited && (engine == "mcts" || engine == "hybrid")) {
+			std::cerr << engine << " needs --time or --nodes" << std::endl;
+			return 1;
+		}
+	}
+
+	Tournament tournament(engines[0], engines[1], settings);
+	const TournamentScore score = tournament.run(std::cout);
+
+	std::cout << argv[1] << " vs " << argv[2] << ": " << score.games() << " games";
+	if (score.timeLosses != 0)
+		std::cout << " (" << score.timeLosses << " lost on time)";
+	std::cout << std::endl;
+	if (settings.sprt) {
+		const int decision = tournament.sprtDecision(score);
+		std::cout << ((decision > 0) ? "H1 accepted" : (decision < 0) ? "H0 accepted" : "SPRT inconclusive")
+			<< " (elo0 " << settings.elo0 << ", elo1 " << settings.elo1 << ")" << std::endl;
+	}
+
+	return 0;
+}
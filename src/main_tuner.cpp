@@ -0,0 +1,82 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "tuner.h"
+
+void usage() {
+	std::cerr << "usage: main_tuner records-file [-o parameters-file] [-t threads] [--passes N] [--start parameters-file]" << std::endl
+		<< "  records-file: games written by main_selfplay" << std::endl
+		<< "  parameters-file: a \"name value\" line per parameter, as read by main_minmax --params" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::ios::sync_with_stdio(false);
+
+	if (argc < 2 || argv[1][0] == '-') {
+		usage();
+		return 1;
+	}
+
+	std::string output = "tuned.params";
+	int nbThreads = std::thread::hardware_concurrency();
+	int maxPasses = 100;
+	ScoringParameters parameters;
+
+	for (int i = 2; i < argc; i++) {
+		const bool hasValue = i+1 < argc;
+
+		if (std::strcmp(argv[i], "-o") == 0 && hasValue)
+			output = argv[++i];
+		else if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+			nbThreads = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--passes") == 0 && hasValue)
+			maxPasses = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--start") == 0 && hasValue) {
+			if (!parameters.load(argv[++i])) {
+				std::cerr << "cannot load parameters from " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	std::ifstream in(argv[1], std::ios::binary);
+	GameRecordReader reader(in);
+	if (!reader.isValid()) {
+		std::cerr << "cannot read game records from " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::vector<TunerPosition> positions;
+	ScoringTuner::load(reader, positions);
+	if (!reader.isValid() || positions.empty()) {
+		std::cerr << "no valid positions in " << argv[1] << std::endl;
+		return 1;
+	}
+	std::cerr << "positions: " << positions.size() << std::endl;
+
+	const auto start = std::chrono::steady_clock::now();
+	ScoringTuner tuner(positions, nbThreads);
+	tuner.fitScale(parameters);
+	std::cerr << "scale: " << tuner.getScale() << std::endl;
+
+	const ScoringParameters tuned = tuner.tune(parameters, maxPasses, std::cerr);
+	const auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << std::fixed << std::setprecision(3) << "elapsed: " << dt << " s" << std::endl;
+
+	if (!tuned.save(output)) {
+		std::cerr << "cannot write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}
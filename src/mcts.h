@@ -1,88 +1,662 @@
 #pragma once
 
-#include <random>
-#include <unordered_map>
-#include <memory>
-#include <queue>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
 #include <cmath>
-#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include "common/board.h"
 #include "common/move.h"
+#include "minmax.h"
+#include "playout.h"
+#include "score.h"
 
 #define UCB_C (1)
 
-typedef struct MCTSNode {
-    Board board;
-    bool myTurn;
-    Move moveGenerator;
+#define RAVE_EQUIVALENCE (0) // games after which UCB and AMAF values weight the same, 0 disables RAVE
+
+#define VIRTUAL_LOSS (PLAYOUT_LANES) // games temporarily counted as lost while a thread explores below a node
+
+#define EXPANSION_THRESHOLD (2*PLAYOUT_LANES) // games played from a leaf before it is expanded
+
+#define MCTS_POOL_SIZE (1 << 21) // nodes, there are two pools to keep the tree between turns
+
+#define TIME_CHECK_EVERY_N_PLAYOUTS (64)
+
+// hybrid mode, depths of the alpha-beta searches looking for forced results
+#define HYBRID_EXPANSION_DEPTH (3) // from each expanded node
+#define HYBRID_ROLLOUT_DEPTH (1) // from each leaf, before its playouts
+#define HYBRID_TABLE_SIZE (1 << 16) // transposition table of each thread
+
+enum ExpansionState : uint8_t {
+    UNEXPANDED = 0,
+    EXPANDING,
+    EXPANDED
+};
+
+/// game theoretic value of a node, for the player that played the move leading to it
+enum Proof : int8_t {
+    UNPROVEN = 0,
+    PROVEN_WIN,
+    PROVEN_LOSS
+};
+
+/** Node statistics are shared by all the threads exploring the tree,
+  * they are updated with relaxed atomics (no lock on the tree).
+  * The results are counted from the point of view of the player that played the move leading to the node.
+  */
+struct MCTSNode {
+    std::atomic<int> nrWin;
+    std::atomic<int> nrLoss;
+    std::atomic<int> nrDraw;
+    std::atomic<int> nrGames;
+
+    // all-moves-as-first statistics, games where the move was played later by the same player
+    // packed to be updated at once: (2*wins + draws) in the high 32 bits, games in the low 32 bits
+    std::atomic<uint64_t> amaf;
 
-    int nrWin;
-    int nrLoss;
-    int nrDraw;
-    int nrGames;
+    // sons are contiguous in the pool, they are only readable once expansion is EXPANDED
+    int firstSon;
+    std::atomic<uint8_t> expansion;
+    std::atomic<int8_t> proven;
+    uint8_t nbSons;
+    Move move;
 
-    std::unordered_map<Move, std::unique_ptr<MCTSNode>> sons;
-    MCTSNode* parent;
+    void reset(Move move) {
+        nrWin.store(0, std::memory_order_relaxed);
+        nrLoss.store(0, std::memory_order_relaxed);
+        nrDraw.store(0, std::memory_order_relaxed);
+        nrGames.store(0, std::memory_order_relaxed);
+        amaf.store(0, std::memory_order_relaxed);
+        firstSon = 0;
+        nbSons = 0;
+        expansion.store(ExpansionState::UNEXPANDED, std::memory_order_relaxed);
+        proven.store(Proof::UNPROVEN, std::memory_order_relaxed);
+        this->move = move;
+    }
+
+    // only used when no thread is searching, firstSon still refers to the pool of that
+    void copy(const MCTSNode& that) {
+        nrWin.store(that.nrWin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nrLoss.store(that.nrLoss.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nrDraw.store(that.nrDraw.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nrGames.store(that.nrGames.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        amaf.store(that.amaf.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        firstSon = that.firstSon;
+        nbSons = that.nbSons;
+        expansion.store(that.expansion.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        proven.store(that.proven.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        move = that.move;
+    }
+
+    /// the win rate is blended with the AMAF win rate (RAVE), the weight of AMAF decreases with the games played
+    float UCB(int N, float raveEquivalence) const {
+        const int games = nrGames.load(std::memory_order_relaxed);
+        const float wins = nrWin.load(std::memory_order_relaxed) + 0.5f * nrDraw.load(std::memory_order_relaxed);
 
-    float UCB() const {
-        int N = (parent != null) ? parent->nrGames : nrGames;
+        float value = wins / (float) games;
 
-        return (float) nrWin / (float) nrGames + UCB_C * std::sqrt(std::log(N) / nrGames);
+        const uint64_t rave = amaf.load(std::memory_order_relaxed);
+        const uint32_t raveGames = rave & 0xFFFFFFFF;
+        if (raveEquivalence > 0 && raveGames > 0) {
+            const float raveWins = 0.5f * (rave >> 32);
+            const float beta = std::sqrt(raveEquivalence / (3 * games + raveEquivalence));
+            value = (1 - beta) * value + beta * raveWins / (float) raveGames;
+        }
+
+        return value + UCB_C * std::sqrt(std::log((float) N) / (float) games);
     }
 };
 
-bool operator<(const MCTSNode& a, const MCTSNode& b) {
-    return a.UCB() < b.UCB();
-}
+/// per player and cell, playouts (among PLAYOUT_LANES) where the player played the cell, packed like MCTSNode::amaf
+struct AMAFCounts {
+    std::array<std::array<uint64_t, 9*9>, 3> counts;
 
-bool operator<=(const MCTSNode& a, const MCTSNode& b) {
-    return a.UCB() <= b.UCB();
-}
+    void clear() {
+        counts[Owner::Player0].fill(0);
+        counts[Owner::Player1].fill(0);
+    }
+
+    inline void add(player_t player, int k, uint32_t cells, player_t winner) {
+        const uint64_t points = (winner == player) ? 2 : (winner == Owner::Draw) ? 1 : 0;
+        const uint64_t count = (points << 32) | 1;
+        while (cells != 0) {
+            counts[player][k*9 + __builtin_ctz(cells)] += count;
+            cells &= cells - 1;
+        }
+    }
+};
+
+using ShallowSearch = MinMaxBasedAI<HYBRID_TABLE_SIZE>;
 
 class MCTSBasedAI {
 public:
-    MCTSBasedAI() {
+    MCTSBasedAI(int nbThreads = std::thread::hardware_concurrency(), bool treeReuse = true, float raveEquivalence = RAVE_EQUIVALENCE)
+        : nbThreads(std::max(nbThreads, 1)), treeReuse(treeReuse), raveEquivalence(raveEquivalence), seed(std::random_device()()) {
+        pools[0].reset(new MCTSNode[MCTS_POOL_SIZE]);
+        pools[1].reset(new MCTSNode[MCTS_POOL_SIZE]);
+        pool = pools[0].get();
     }
 
-    Move play(Board& board, bool myTurn, const Move& givenMoveGenerator, double timeBudget) {
-        this->timeBudget = timeBudget;
+    /// the search stops after this number of games (or the time budget), 0 for no limit
+    void setPlayoutsLimit(long limit) {
+        playoutsLimit = limit;
+    }
 
-        movesGenerator[0] = givenMoveGenerator;
+    /// no statistics on the standard error (when several searches run at once)
+    void setVerbose(bool verbose) {
+        this->verbose = verbose;
+    }
 
-        exploredPositions = 0;
-        MoveValued bestMoveValued = {Move::end, -1};
+    /** MCTS-minimax hybrid: shallow alpha-beta searches prove forced wins and losses
+      * of expanded nodes and of leaves before their playouts.
+      * Each thread has its own search (and table), unrelated to any MinMaxBasedAI of the caller.
+      */
+    void enableHybrid(const Scoring& scoring) {
+        shallowSearches.clear();
+        for (int i = 0; i < nbThreads; i++) {
+            shallowSearches.emplace_back(new ShallowSearch(scoring));
+        }
+    }
 
-        MCTSNode root = {
-            std::copy(board),
-            myTurn,
-            std::copy(givenMoveGenerator),
-            0,
-            0,
-            0,
+    Move play(Board& board, player_t startingPlayer, const Move& givenMoveGenerator, double timeBudget) {
+        start = std::chrono::steady_clock::now();
+        this->timeBudget = timeBudget/1000.;
+
+        rootBoard = &board;
+        rootPlayer = startingPlayer;
+        rootMoveGenerator = givenMoveGenerator;
+
+        // continue the search of the previous turn if we find the current position in the tree
+        const int reusedGames = (treeReuse && hasTree && promote(board, startingPlayer, givenMoveGenerator))
+            ? pool[0].nrGames.load(std::memory_order_relaxed)
+            : 0;
+        if (reusedGames == 0) {
+            poolUsed.store(1, std::memory_order_relaxed);
+            pool[0].reset(Move::end);
+        }
+
+        // the root always has sons, even if it is solved before its first playout
+        if (pool[0].expansion.load(std::memory_order_relaxed) != ExpansionState::EXPANDED) {
+            std::array<MoveValued, 9*9+1> moves;
+            expand(pool[0], board, givenMoveGenerator, startingPlayer, moves, shallowSearches.empty() ? nullptr : shallowSearches[0].get());
+        }
+        playouts.store(0, std::memory_order_relaxed);
+
+        // a proven root (from the previous turn) does not need more search
+        stop.store(pool[0].proven.load(std::memory_order_relaxed) != Proof::UNPROVEN, std::memory_order_relaxed);
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < nbThreads; i++) {
+            workers.emplace_back(&MCTSBasedAI::search, this, i);
+        }
+        search(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        // a proven win, otherwise the most played move that is not a proven loss
+        const MCTSNode& root = pool[0];
+        const MCTSNode* best = nullptr;
+        if (root.expansion.load(std::memory_order_acquire) == ExpansionState::EXPANDED) {
+            for (int i = 0; i < root.nbSons; i++) {
+                const MCTSNode& son = pool[root.firstSon + i];
+                if (best == nullptr || preferred(son, *best)) {
+                    best = &son;
+                }
+            }
+        }
+        const Move bestMove = (best != nullptr) ? best->move : Move::end;
+
+        hasTree = (best != nullptr);
+        lastBoard = board;
+        lastPlayer = startingPlayer;
+        lastMove = bestMove;
+
+        if (verbose) {
+            printStatistics(root, best, reusedGames);
+        }
+
+        return bestMove;
+    }
+
+private:
+    void printStatistics(const MCTSNode& root, const MCTSNode* best, int reusedGames) const {
+        const Move bestMove = (best != nullptr) ? best->move : Move::end;
+        const auto dt = elapsedInMs();
+        const auto nrPlayouts = playouts.load(std::memory_order_relaxed);
+        std::cerr << std::fixed << std::setprecision(3)
+            << "elapsed : " << dt << " s" << ", threads: " << nbThreads << ", playouts: " << nrPlayouts << ", playouts/s: " << nrPlayouts/dt << ", nodes: " << std::min(poolUsed.load(), MCTS_POOL_SIZE)
+            << ", tree games: " << root.nrGames << " (reused: " << reusedGames << ")" << std::endl;
+        if (best != nullptr) {
+            std::cerr << "choice win%: " << 100. * (best->nrWin + 0.5 * best->nrDraw) / best->nrGames << ", games: " << best->nrGames
+                << ", proven: " << ((best->proven == Proof::PROVEN_WIN) ? "win" : (best->proven == Proof::PROVEN_LOSS) ? "loss" : "no")
+                << " (Y, X, y, x): " << bestMove.Y() << ' ' << bestMove.X() << ' ' << bestMove.y() << ' ' << bestMove.x() << std::endl;
+        }
+        std::cerr << std::endl;
+    }
+
+    double elapsedInMs() const {
+        const auto now = std::chrono::steady_clock::now();
+        const auto dt = std::chrono::duration <double, std::ratio<1>> (now - start).count();
+        return dt;
+    }
+
+    bool timeBudgetExceeded() const {
+        return elapsedInMs() >= timeBudget;
+    }
+
+    static bool preferred(const MCTSNode& a, const MCTSNode& b) {
+        const auto rank = [](const MCTSNode& node) {
+            const int8_t proven = node.proven.load(std::memory_order_relaxed);
+            return (proven == Proof::PROVEN_WIN) ? 2 : (proven == Proof::UNPROVEN) ? 1 : 0;
+        };
+
+        if (rank(a) != rank(b)) {
+            return rank(a) > rank(b);
+        }
+        return a.nrGames.load(std::memory_order_relaxed) > b.nrGames.load(std::memory_order_relaxed);
+    }
+
+    /** Looks for the current position two plies below the previous root (our move, then the opponent's reply),
+      * and moves that subtree to the other pool, where it becomes the root.
+      * The rest of the previous tree is freed at once by reusing its pool for the next turn.
+      */
+    bool promote(const Board& board, player_t player, const Move& moveGenerator) {
+        if (player != lastPlayer || pool[0].expansion.load(std::memory_order_relaxed) != ExpansionState::EXPANDED) {
+            return false;
+        }
+
+        const MCTSNode* ours = nullptr;
+        for (int i = 0; i < pool[0].nbSons; i++) {
+            if (pool[pool[0].firstSon + i].move == lastMove) {
+                ours = &pool[pool[0].firstSon + i];
+            }
+        }
+        if (ours == nullptr || ours->expansion.load(std::memory_order_relaxed) != ExpansionState::EXPANDED) {
+            return false;
+        }
+
+        Board expected = lastBoard;
+        expected.action(lastMove, lastPlayer);
+        for (int i = 0; i < ours->nbSons; i++) {
+            const MCTSNode& reply = pool[ours->firstSon + i];
+
+            expected.action(reply.move, OTHER(lastPlayer));
+            const Move expectedMoveGenerator = expected.isWonOrFull_d(reply.move.yx()) ? Move::any : reply.move;
+            const bool found = (expected.getBoard() == board.getBoard())
+                && (expectedMoveGenerator == Move::any) == (moveGenerator == Move::any)
+                && (moveGenerator == Move::any || expectedMoveGenerator.yx() == moveGenerator.yx());
+            expected.cancel();
+
+            if (found) {
+                copySubtree(reply);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // breadth first copy to the other pool, sons stay contiguous
+    void copySubtree(const MCTSNode& root) {
+        MCTSNode* from = pool;
+        MCTSNode* to = (pool == pools[0].get()) ? pools[1].get() : pools[0].get();
+
+        to[0].copy(root);
+        int used = 1;
+        for (int i = 0; i < used; i++) {
+            MCTSNode& node = to[i];
+            if (node.expansion.load(std::memory_order_relaxed) != ExpansionState::EXPANDED) {
+                node.expansion.store(ExpansionState::UNEXPANDED, std::memory_order_relaxed);
+                node.nbSons = 0;
+                continue;
+            }
+
+            const int firstSon = node.firstSon;
+            node.firstSon = used;
+            for (int j = 0; j < node.nbSons; j++) {
+                to[used++].copy(from[firstSon + j]);
+            }
+        }
+
+        pool = to;
+        poolUsed.store(used, std::memory_order_relaxed);
+    }
+
+    // body of each thread, every thread works on its own copy of the board
+    void search(int threadIndex) {
+        std::seed_seq seq = {seed, static_cast<unsigned int>(threadIndex), static_cast<unsigned int>(rootBoard->actionsSize())};
+        std::array<uint32_t, 1> engineSeed;
+        seq.generate(engineSeed.begin(), engineSeed.end());
+        PlayoutEngine engine(engineSeed[0]);
+        ShallowSearch* shallowSearch = shallowSearches.empty() ? nullptr : shallowSearches[threadIndex].get();
+
+        Board board = *rootBoard;
+        std::array<MCTSNode*, 9*9+1> path;
+        std::array<MoveValued, 9*9+1> moves;
+        std::array<int, 4> results;
+        AMAFCounts amaf;
+
+        for (long n = 1; !stop.load(std::memory_order_relaxed); n++) {
+            const int pathLength = descend(board, path, moves, engine, shallowSearch, results);
+            backpropagate(path, pathLength, results);
+            propagateProof(path, pathLength);
+
+            if (raveEquivalence > 0) {
+                // the engine only played games if the leaf was not terminal (nor proven)
+                const bool playedOut = (board.winner() == Owner::None && path[pathLength-1]->proven.load(std::memory_order_relaxed) == Proof::UNPROVEN);
+                updateAMAF(path, pathLength, results, playedOut ? &engine : nullptr, amaf);
+            }
+
+            while (board.actionsSize() != rootBoard->actionsSize()) {
+                board.cancel();
+            }
+
+            const long nrPlayouts = playouts.fetch_add(PLAYOUT_LANES, std::memory_order_relaxed) + PLAYOUT_LANES;
+            if (pool[0].proven.load(std::memory_order_relaxed) != Proof::UNPROVEN
+                    || (playoutsLimit != 0 && nrPlayouts >= playoutsLimit)
+                    || (n % TIME_CHECK_EVERY_N_PLAYOUTS == 0 && timeBudgetExceeded())) {
+                stop.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // selection, expansion, then random playouts until the end of the game, returns the length of the path in the tree
+    int descend(Board& board, std::array<MCTSNode*, 9*9+1>& path, std::array<MoveValued, 9*9+1>& moves, PlayoutEngine& engine, ShallowSearch* shallowSearch, std::array<int, 4>& results) {
+        player_t player = rootPlayer;
+        Move moveGenerator = rootMoveGenerator;
+
+        MCTSNode* node = &pool[0];
+        int pathLength = 0;
+        path[pathLength++] = node;
+
+        // proven nodes are not searched anymore, their result is known
+        while (board.winner() == Owner::None && node->proven.load(std::memory_order_relaxed) == Proof::UNPROVEN) {
+            if (node->expansion.load(std::memory_order_acquire) != ExpansionState::EXPANDED
+                    && !(node->nrGames.load(std::memory_order_relaxed) >= EXPANSION_THRESHOLD && expand(*node, board, moveGenerator, player, moves, shallowSearch))) {
+                break;
+            }
+            if (node->proven.load(std::memory_order_relaxed) != Proof::UNPROVEN) {
+                break; // solved by the expansion
+            }
+
+            node = select(*node);
+            node->nrGames.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+            path[pathLength++] = node;
+
+            board.action(node->move, player);
+            moveGenerator = board.isWonOrFull_d(node->move.yx()) ? Move::any : node->move;
+            player = OTHER(player);
+        }
+
+        rollout(*node, board, player, moveGenerator, engine, shallowSearch, results);
+        return pathLength;
+    }
+
+    // only one thread can expand a node, the others continue with a playout
+    bool expand(MCTSNode& node, Board& board, const Move& moveGenerator, player_t player, std::array<MoveValued, 9*9+1>& moves, ShallowSearch* shallowSearch) {
+        if (poolUsed.load(std::memory_order_relaxed) >= MCTS_POOL_SIZE) {
+            return false;
+        }
+
+        uint8_t expected = ExpansionState::UNEXPANDED;
+        if (!node.expansion.compare_exchange_strong(expected, ExpansionState::EXPANDING, std::memory_order_acquire)) {
+            return false;
+        }
+
+        board.possibleMoves(moves, moveGenerator);
+        int nbMoves = 0;
+        while (moves[nbMoves].move != Move::end) {
+            nbMoves++;
+        }
+
+        const int first = poolUsed.fetch_add(nbMoves, std::memory_order_relaxed);
+        if (first + nbMoves > MCTS_POOL_SIZE) {
+            node.expansion.store(ExpansionState::UNEXPANDED, std::memory_order_relaxed);
+            return false;
+        }
+
+        for (int i = 0; i < nbMoves; i++) {
+            MCTSNode& son = pool[first + i];
+            son.reset(moves[i].move);
+
+            // moves ending the game are proven right away
+            board.action(son.move, player);
+            if (board.winner() == player) {
+                son.proven.store(Proof::PROVEN_WIN, std::memory_order_relaxed);
+            }
+            board.cancel();
+        }
+        node.firstSon = first;
+        node.nbSons = nbMoves;
+        node.expansion.store(ExpansionState::EXPANDED, std::memory_order_release);
+
+        if (shallowSearch != nullptr) {
+            const MoveValued forced = solve(*shallowSearch, node, board, player, moveGenerator, HYBRID_EXPANSION_DEPTH);
+            if (forced.value > 0) {
+                for (int i = 0; i < nbMoves; i++) {
+                    if (pool[first + i].move == forced.move) {
+                        pool[first + i].proven.store(Proof::PROVEN_WIN, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /** Alpha-beta search of the node, proves it won (for the player that moved into it) if all the moves lose.
+      * Returns a positive value with the winning move if player has a forced win, 0 otherwise.
+      */
+    MoveValued solve(ShallowSearch& shallowSearch, MCTSNode& node, Board& board, player_t player, const Move& moveGenerator, int depth) {
+        const MoveValued best = shallowSearch.search(board, player, moveGenerator, depth);
+
+        if (isDraw(best.value) || std::abs(best.value) < GLOBAL_VICTORY0_SCORE-MAX_DEPTH) {
+            return {Move::end, 0};
+        }
+        if (best.value < 0) {
+            node.proven.store(Proof::PROVEN_WIN, std::memory_order_relaxed);
+            return {Move::end, 0};
+        }
+        return {best.move, 1};
+    }
+
+    MCTSNode* select(const MCTSNode& node) {
+        const int N = std::max(node.nrGames.load(std::memory_order_relaxed), 1);
+
+        MCTSNode* best = &pool[node.firstSon];
+        float bestUCB = -1;
+        for (int i = 0; i < node.nbSons; i++) {
+            MCTSNode* son = &pool[node.firstSon + i];
+
+            // a winning move is always played, a losing one never (unless they all lose)
+            const int8_t proven = son->proven.load(std::memory_order_relaxed);
+            if (proven == Proof::PROVEN_WIN) {
+                return son;
+            }
+            if (proven == Proof::PROVEN_LOSS) {
+                continue;
+            }
+
+            // never explored
+            if (son->nrGames.load(std::memory_order_relaxed) == 0) {
+                return son;
+            }
+
+            const float ucb = son->UCB(N, raveEquivalence);
+            if (ucb > bestUCB) {
+                best = son;
+                bestUCB = ucb;
+            }
+        }
+        return best;
+    }
+
+    // results[owner] is the number of games won by owner (or drawn) among the PLAYOUT_LANES games
+    void rollout(MCTSNode& node, Board& board, player_t player, const Move& moveGenerator, PlayoutEngine& engine, ShallowSearch* shallowSearch, std::array<int, 4>& results) {
+        results.fill(0);
+
+        // a terminal or proven node counts as many games as a playout
+        if (board.winner() != Owner::None) {
+            results[board.winner()] = PLAYOUT_LANES;
+            return;
+        }
+        // forced results are not left to random playouts
+        if (HYBRID_ROLLOUT_DEPTH > 0 && shallowSearch != nullptr && solve(*shallowSearch, node, board, player, moveGenerator, HYBRID_ROLLOUT_DEPTH).value > 0) {
+            node.proven.store(Proof::PROVEN_LOSS, std::memory_order_relaxed);
+        }
+
+        const int8_t proven = node.proven.load(std::memory_order_relaxed);
+        if (proven != Proof::UNPROVEN) {
+            // the node was reached by a move of the other player
+            results[(proven == Proof::PROVEN_WIN) ? OTHER(player) : player] = PLAYOUT_LANES;
+            return;
+        }
+
+        std::array<player_t, PLAYOUT_LANES> winners;
+        engine.run(board, player, moveGenerator, winners);
+        for (const player_t winner : winners) {
+            results[winner]++;
+        }
+    }
+
+    /** MCTS-Solver, from the leaf to the root:
+      * a node is lost if one of its sons is won (by the opponent), and won if all its sons are lost.
+      */
+    void propagateProof(const std::array<MCTSNode*, 9*9+1>& path, int pathLength) {
+        for (int i = pathLength - 1; i >= 0; i--) {
+            MCTSNode& node = *path[i];
+            if (node.proven.load(std::memory_order_relaxed) != Proof::UNPROVEN) {
+                continue;
+            }
+            if (node.expansion.load(std::memory_order_acquire) != ExpansionState::EXPANDED) {
+                return;
+            }
+
+            int8_t proof = Proof::PROVEN_WIN;
+            for (int j = 0; j < node.nbSons; j++) {
+                const int8_t proven = pool[node.firstSon + j].proven.load(std::memory_order_relaxed);
+                if (proven == Proof::PROVEN_WIN) {
+                    proof = Proof::PROVEN_LOSS;
+                    break;
+                }
+                if (proven == Proof::UNPROVEN) {
+                    proof = Proof::UNPROVEN;
+                }
+            }
+
+            if (proof == Proof::UNPROVEN) {
+                return;
+            }
+            node.proven.store(proof, std::memory_order_relaxed);
+        }
+    }
+
+    /** RAVE, the sons of every node of the path get the results of the games
+      * where the player to move at the node played the move of the son later (in the tree or in the playouts).
+      */
+    void updateAMAF(const std::array<MCTSNode*, 9*9+1>& path, int pathLength, const std::array<int, 4>& results, const PlayoutEngine* engine, AMAFCounts& amaf) {
+        amaf.clear();
+
+        if (engine != nullptr) {
+            const PlayoutLanes& lanes = engine->getLanes();
+            const auto& startCells = engine->getStartCells();
+
+            for (int lane = 0; lane < PLAYOUT_LANES; lane++) {
+                const player_t winner = lanes.winner[lane];
+                for (int k = 0; k < 9; k++) {
+                    const uint32_t played = lanes.cells[k][lane] & ~startCells[k];
+                    amaf.add(Owner::Player0, k, played & CELLS_MASK, winner);
+                    amaf.add(Owner::Player1, k, (played >> PLAYER1_SHIFT) & CELLS_MASK, winner);
+                }
+            }
+        }
+
+        // moves of the path below the current node, all the games played them
+        std::array<std::bitset<9*9>, 3> inTree;
+        const uint64_t treeCount[3] = {
             0,
-            std::unordered_map<Move, std::unique_ptr<MCTSNode>>()
+            ((uint64_t) (2*results[Owner::Player0] + results[Owner::Draw]) << 32) | PLAYOUT_LANES,
+            ((uint64_t) (2*results[Owner::Player1] + results[Owner::Draw]) << 32) | PLAYOUT_LANES
         };
 
-        std::priority_queue<MCTSNode*> nodesPQ;
+        for (int i = pathLength - 1; i >= 0; i--) {
+            const MCTSNode& node = *path[i];
+            const player_t player = (i % 2 == 0) ? rootPlayer : OTHER(rootPlayer);
+
+            if (i + 1 < pathLength) {
+                inTree[player].set(path[i+1]->move.j);
+            }
+            if (node.expansion.load(std::memory_order_acquire) != ExpansionState::EXPANDED) {
+                continue;
+            }
+
+            for (int j = 0; j < node.nbSons; j++) {
+                MCTSNode& son = pool[node.firstSon + j];
+                const int cell = son.move.j;
+
+                const uint64_t count = inTree[player].test(cell) ? treeCount[player] : amaf.counts[player][cell];
+                if (count != 0) {
+                    son.amaf.fetch_add(count, std::memory_order_relaxed);
+                }
+            }
+        }
     }
 
-    // node is supposed to be non terminal
-    void expand(MCTSNode& node) {
-        //TODO à terminer pour clem120
+    void backpropagate(const std::array<MCTSNode*, 9*9+1>& path, int pathLength, const std::array<int, 4>& results) {
+        // the root move was played by the opponent
+        player_t mover = OTHER(rootPlayer);
+
+        for (int i = 0; i < pathLength; i++) {
+            MCTSNode& node = *path[i];
+
+            node.nrWin.fetch_add(results[mover], std::memory_order_relaxed);
+            node.nrDraw.fetch_add(results[Owner::Draw], std::memory_order_relaxed);
+            node.nrLoss.fetch_add(results[OTHER(mover)], std::memory_order_relaxed);
 
-        //TODO attention, peut on vraiment expand le node ?
+            // remove the virtual loss added during selection
+            node.nrGames.fetch_add((i == 0) ? PLAYOUT_LANES : PLAYOUT_LANES - VIRTUAL_LOSS, std::memory_order_relaxed);
+
+            mover = OTHER(mover);
+        }
     }
 
 private:
-    std::array<Move, MAX_DEPTH+1> movesGenerator; // move of the previous level
-    std::array<std::array<MoveValued, 9*9+1>, MAX_DEPTH+1> moves;
+    const int nbThreads;
+    const bool treeReuse;
+    const float raveEquivalence;
+    long playoutsLimit = 0;
+    bool verbose = true;
 
-    double timeBudget;
-	std::chrono::time_point<std::chrono::steady_clock> start;
+    std::vector<std::unique_ptr<ShallowSearch>> shallowSearches; // one per thread, empty if not hybrid
+
+    // nodes are allocated once, a search only bumps the number of used nodes
+    std::array<std::unique_ptr<MCTSNode[]>, 2> pools;
+    MCTSNode* pool; // pool of the current tree
+    std::atomic<int> poolUsed;
+
+    // previous search, to find the current position in its tree
+    bool hasTree = false;
+    Board lastBoard;
+    player_t lastPlayer;
+    Move lastMove;
 
-    int previousExploredPositions;
-    int exploredPositions;
+    const Board* rootBoard;
+    player_t rootPlayer;
+    Move rootMoveGenerator;
 
+    const unsigned int seed;
 
-}
+    std::atomic<bool> stop;
+    std::atomic<long> playouts;
+
+    double timeBudget;
+    std::chrono::time_point<std::chrono::steady_clock> start;
+};
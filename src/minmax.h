@@ -3,12 +3,20 @@
 #include <array>
 #include <algorithm>
 #include <iostream>
+#include <iomanip>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
 
 #include "common/move.h"
 #include "common/board.h"
 #include "score.h"
 #include "transposition_table.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "probcut.h"
 
 #define MIN_DEPTH (1)
 #define MAX_DEPTH (81)
@@ -17,36 +25,138 @@
 
 #define TABLE_CUTOFF (2)
 
-template<int TableSize>
+#define ETC_MIN_DEPTH (5) // remaining depth from which the children are looked up in the table before being searched
+
+#define IID_MIN_DEPTH (5) // remaining depth from which a node without hash move is first searched shallower to find one
+#define IID_REDUCTION (2) // depth of that search = remaining depth - IID_REDUCTION
+
+// ordering terms of a move by the sub-board it sends the opponent to
+#define FREE_MOVE_PENALTY (20) // won or full: the opponent can play anywhere
+#define WIN_IN_ONE_BONUS (10) // the opponent can win it with one move
+
+struct SearchResult {
+    MoveValued best; /// value from the point of view of the player to move
+    int depth; /// last completed depth
+    long positions;
+    double elapsed; /// in seconds
+    std::vector<Move> pv; /// principal variation, starting with best.move
+};
+
+/// called for each line of each completed depth, with its index among the multi-PV lines
+using InfoCallback = std::function<void(const SearchResult& line, int multiPvIndex)>;
+
+/// Evaluator is Scoring or NnueScoring, the table has TableSize entries unless tableSize (a power of two) is given
+template<int TableSize, class Evaluator = Scoring>
 class MinMaxBasedAI {
 public:
-    MinMaxBasedAI(const Scoring& scoring) : scoring(scoring) {        
+    MinMaxBasedAI(const Evaluator& scoring, long tableSize = TableSize) : ttable(tableSize), scoring(scoring) {
     }
 
     Move play(Board& board, player_t startingPlayer, const Move& givenMoveGenerator, double timeBudget) {
+#ifdef SEARCH_PROFILER
+        profiler.reset();
+#endif
+        const SearchResult result = analyse(board, startingPlayer, givenMoveGenerator, timeBudget);
+
+        const auto dt = result.elapsed;
+        std::cerr << std::fixed
+            << "score: " << decodeDraw(scoring.score(board)) << ", best: " << result.best.value << ", elapsed : " << dt << " ms" << ", positions: " << result.positions << ", positions/s: " << result.positions/dt << std::endl
+            << "choice D" << result.depth << " (Y, X, y, x): " << result.best.move.Y() << ' ' << result.best.move.X() << ' ' << result.best.move.y() << ' ' << result.best.move.x() << std::endl
+            << std::endl;
+#ifdef SEARCH_PROFILER
+        profiler.print(std::cerr);
+        std::cerr << std::endl;
+#endif
+
+        return result.best.move;
+    }
+
+    /// iterative deepening until the time budget (in ms) is spent or depthLimit is completed
+    SearchResult analyse(Board& board, player_t startingPlayer, const Move& givenMoveGenerator, double timeBudget, int depthLimit = MAX_DEPTH) {
         start = std::chrono::steady_clock::now();
         this->timeBudget = timeBudget/1000.;
+        this->depthLimit = depthLimit;
         movesGenerator[0] = givenMoveGenerator;
+        scoring.attach(board, accumulator);
 
         exploredPositions = 0;
-        MoveValued bestMoveValued = {Move::end, -1};
+        abortReason = nullptr;
+        SearchResult result;
+        result.best = {Move::end, -1};
+        result.depth = 0;
         maxDepth = MIN_DEPTH;
         try {
-            iterativeDeepening(bestMoveValued, board, startingPlayer);
+            iterativeDeepening(result, board, startingPlayer);
         }
         // last deepening was aborted
         catch (int) {
-            maxDepth--;
-            std::cerr << "aborting next deepening" << std::endl;
+            if (verbose) {
+                std::cerr << "aborting next deepening" << std::endl;
+            }
         }
+        board.attach(nullptr);
+        excludedRootMoves.clear();
 
-        const auto dt = elapsedInMs();
-        std::cerr << std::fixed
-            << "score: " << decodeDraw(scoring.score(board)) << ", best: " << bestMoveValued.value << ", elapsed : " << dt << " ms" << ", positions: " << exploredPositions << ", positions/s: " << exploredPositions/dt << std::endl
-            << "choice D" << maxDepth << " (Y, X, y, x): " << bestMoveValued.move.Y() << ' ' << bestMoveValued.move.X() << ' ' << bestMoveValued.move.y() << ' ' << bestMoveValued.move.x() << std::endl
-            << std::endl;
+        result.positions = exploredPositions;
+        result.elapsed = elapsedInMs();
+
+        if (telemetry != nullptr) {
+            writeMoveTelemetry(result);
+        }
+        return result;
+    }
+
+    /// no statistics on the standard error (when several searches run at once)
+    void setVerbose(bool verbose) {
+        this->verbose = verbose;
+    }
+
+    /// the search aborts like on time out after this number of positions, 0 for no limit
+    void setPositionsLimit(long limit) {
+        positionsLimit = limit;
+    }
+
+    /// number of best root moves searched with their own line at each depth
+    void setMultiPv(int multiPv) {
+        this->multiPv = std::max(1, std::min(multiPv, 9*9));
+    }
 
-        return bestMoveValued.move;
+    /// a search aborts like on time out when flag is set (by another thread)
+    void setStopFlag(const std::atomic<bool>* flag) {
+        stopFlag = flag;
+    }
+
+    void setInfoCallback(const InfoCallback& callback) {
+        infoCallback = callback;
+    }
+
+    /// forward pruning, off with the default parameters
+    void setProbCut(const ProbCutParameters& parameters) {
+        probCut = parameters;
+    }
+
+    /// a JSON line per completed depth and per move, nullptr (the default) for none
+    void setTelemetry(TelemetrySink* sink) {
+        telemetry = (sink != nullptr && sink->enabled()) ? sink : nullptr;
+    }
+
+    /// forgets the positions searched so far, the next search doesn't depend on the previous ones
+    void clearTable() {
+        ttable.clear();
+    }
+
+    /// fixed depth search without time limit, the value is from the point of view of player
+    MoveValued search(Board& board, player_t player, const Move& givenMoveGenerator, int depth) {
+        start = std::chrono::steady_clock::now();
+        timeBudget = std::numeric_limits<double>::infinity();
+        movesGenerator[0] = givenMoveGenerator;
+        maxDepth = depth;
+        excludedRootMoves.clear();
+        scoring.attach(board, accumulator);
+
+        const auto best = minmax(board, 0, depth, player, MIN_NEGATABLE_SCORE, MAX_NEGATABLE_SCORE);
+        board.attach(nullptr);
+        return best;
     }
 
 private:
@@ -57,17 +167,45 @@ private:
     }
 
     bool timeBudgetExceeded() const {
-        return elapsedInMs() >= timeBudget;
+        return (stopFlag != nullptr && stopFlag->load(std::memory_order_relaxed)) || elapsedInMs() >= timeBudget;
     }
 
-    void iterativeDeepening(MoveValued& best, Board& board, player_t startingPlayer) {
+    void iterativeDeepening(SearchResult& result, Board& board, player_t startingPlayer) {
         // while we don't have a win/loss
-        while (!isDraw(best.value) && std::abs(best.value) < GLOBAL_VICTORY0_SCORE-MAX_DEPTH) {
+        while (!isDraw(result.best.value) && std::abs(result.best.value) < GLOBAL_VICTORY0_SCORE-MAX_DEPTH && maxDepth <= depthLimit) {
             previousExploredPositions = exploredPositions;
+            const TranspositionTableCounters previousCounters = ttable.counters;
+            const long previousCutoffs = cutoffs;
+            const long previousFirstMoveCutoffs = firstMoveCutoffs;
+
+            // each line is the best root move among the ones not already in a line
+            excludedRootMoves.clear();
+            for (int line = 0; line < multiPv; line++) {
+                SearchResult current;
+                current.best = minmax(board, 0, maxDepth, startingPlayer, MIN_NEGATABLE_SCORE, MAX_NEGATABLE_SCORE);
+                if (current.best.move == Move::end) {
+                    break; // fewer root moves than lines
+                }
+                current.depth = maxDepth;
+                current.positions = exploredPositions;
+                current.elapsed = elapsedInMs();
+                current.pv.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
 
-            best = minmax(board, 0, maxDepth, startingPlayer, MIN_NEGATABLE_SCORE, MAX_NEGATABLE_SCORE);
+                if (line == 0) {
+                    result = current;
+                }
+                if (infoCallback) {
+                    infoCallback(current, line);
+                }
+                excludedRootMoves.push_back(current.best.move);
+            }
 
-            printStatistics();
+            if (verbose) {
+                printStatistics();
+            }
+            if (telemetry != nullptr) {
+                writeDepthTelemetry(previousCounters, cutoffs - previousCutoffs, firstMoveCutoffs - previousFirstMoveCutoffs);
+            }
 
             maxDepth++; // explore one level deeper
         }
@@ -88,34 +226,111 @@ private:
             << ", use%: " << usageRatio << std::endl;
     }
 
+    void writeDepthTelemetry(const TranspositionTableCounters& previous, long iterationCutoffs, long iterationFirstMoveCutoffs) {
+        const auto& counters = ttable.counters;
+        const long nodes = exploredPositions - previousExploredPositions;
+        const long gets = counters.get - previous.get;
+        const long puts = counters.put - previous.put;
+        const double elapsed = elapsedInMs();
+
+        JsonLine line;
+        line.add("event", "depth")
+            .add("depth", maxDepth)
+            .add("nodes", nodes)
+            .add("total_nodes", exploredPositions)
+            .add("nps", (long) (elapsed > 0 ? exploredPositions / elapsed : 0))
+            .add("ebf", previousIterationNodes > 0 ? (double) nodes / previousIterationNodes : 0.)
+            .add("first_move_cutoff", iterationCutoffs > 0 ? (double) iterationFirstMoveCutoffs / iterationCutoffs : 0.)
+            .add("tt_hit", gets > 0 ? (double) (counters.hit - previous.hit) / gets : 0.)
+            .add("tt_miss", gets > 0 ? (double) (counters.miss - previous.miss) / gets : 0.)
+            .add("tt_collisions", puts > 0 ? (double) (counters.collisions - previous.collisions) / puts : 0.)
+            .add("tt_use", counters.capacity > 0 ? (double) counters.count / counters.capacity : 0.)
+            .add("time_ms", elapsed * 1000)
+            .add("budget_ms", timeBudget * 1000);
+        telemetry->write(line);
+        previousIterationNodes = nodes;
+    }
+
+    void writeMoveTelemetry(const SearchResult& result) {
+        // without abort, the search ended on a proven result or on its depth limit
+        const char* reason = (abortReason != nullptr) ? abortReason
+            : (isDraw(result.best.value) || std::abs(result.best.value) >= GLOBAL_VICTORY0_SCORE-MAX_DEPTH) ? "solved"
+            : "depth_limit";
+
+        JsonLine line;
+        line.add("event", "move")
+            .add("depth", result.depth)
+            .add("nodes", result.positions)
+            .add("nps", (long) (result.elapsed > 0 ? result.positions / result.elapsed : 0))
+            .add("time_ms", result.elapsed * 1000)
+            .add("budget_ms", timeBudget * 1000)
+            .add("abort", reason)
+            .add("x", result.best.move.X()*3 + result.best.move.x())
+            .add("y", result.best.move.Y()*3 + result.best.move.y())
+            .add("score", (long) decodeDraw(result.best.value));
+        telemetry->write(line);
+        previousIterationNodes = 0;
+    }
+
+    /// search of a node whose player and move generator are only known at runtime (the root)
     MoveValued minmax(Board& board, int depth, int maxDepth, player_t player, score_t A, score_t B) {
+        const bool free = (movesGenerator[depth] == Move::any);
+        if (player == Owner::Player0) {
+            return free ? negamax<Owner::Player0, true>(board, depth, maxDepth, A, B) : negamax<Owner::Player0, false>(board, depth, maxDepth, A, B);
+        }
+        return free ? negamax<Owner::Player1, true>(board, depth, maxDepth, A, B) : negamax<Owner::Player1, false>(board, depth, maxDepth, A, B);
+    }
+
+    /// Player is to move, Free when movesGenerator[depth] is Move::any: the 4 versions call each other without these tests
+    template<player_t Player, bool Free>
+    MoveValued negamax(Board& board, int depth, int maxDepth, score_t A, score_t B) {
+        constexpr int sign = (Player == Owner::Player0) ? 1 : -1;
+
         exploredPositions++;
+        pvLength[depth] = depth;
 
         if (exploredPositions % TIME_CHECK_EVERY_N_POSITIONS == 0) {
-            if (timeBudgetExceeded()) {
+            PROFILE_START(timeCheck);
+            const bool exceeded = timeBudgetExceeded();
+            PROFILE_STOP(timeCheck, maxDepth - depth, TIME_CHECK);
+            if (exceeded) {
+                abortReason = (stopFlag != nullptr && stopFlag->load(std::memory_order_relaxed)) ? "stop" : "time";
                 throw 0;
             }
         }
+        if (positionsLimit != 0 && exploredPositions > positionsLimit) {
+            abortReason = "positions";
+            throw 0;
+        }
 
         ExploredPositionType type = ExploredPositionType::UPPER;
         MoveValued best = {Move::end, -GLOBAL_VICTORY0_SCORE-1};
 
-        if (board.winner() != Owner::None || depth == maxDepth) {
+        // the root of a game drawn early is searched for a move to play, all its children are draws
+        if ((depth == 0 ? board.isOver() : board.winner() != Owner::None) || depth == maxDepth) {
+            PROFILE_START(leaf);
             const auto score = scoring.score(board);
+            PROFILE_STOP(leaf, maxDepth - depth, LEAF_SCORE);
 
             if (isDraw(score))
                 best.value = score;
             else
-                best.value = ((player == Owner::Player0) ? 1 : -1) * score;
+                best.value = sign * score;
 
             return best; // no need to save this position
         }
         else {
+            // root searches of the next multi-PV lines skip some moves, they don't use or update the table
+            const bool restricted = (depth == 0 && !excludedRootMoves.empty());
+
             // try to find current position in transposition table
-            const ExploredPosition* pos = (maxDepth - depth >= TABLE_CUTOFF)
-                ? ttable.get(board.getBoard(), player, movesGenerator[depth])
+            PROFILE_START(probe);
+            const ExploredPosition* pos = (!restricted && maxDepth - depth >= TABLE_CUTOFF)
+                ? ttable.get(board.getBoard(), Player, movesGenerator[depth])
                 : nullptr;
             
+            PROFILE_STOP(probe, maxDepth - depth, TABLE_PROBE);
+
             MoveValued hashMove = {Move::end, -1};
             if (pos != nullptr) {
                 // saved move heuristic
@@ -127,12 +342,15 @@ private:
                     // stored result is relevant
                     if ((maxDepth - depth) <= pos->depthBelow) {
 
-                        if (pos->type == ExploredPositionType::EXACT)
+                        if (pos->type == ExploredPositionType::EXACT) {
+                            setPv(depth, hashMove.move, false);
                             return hashMove;
+                        }
 
                         else if (pos->type == ExploredPositionType::LOWER) {
                             if (decodeDraw(hashMove.value) > decodeDraw(best.value)) {
                                 best = hashMove;
+                                setPv(depth, hashMove.move, false);
 
                                 if (decodeDraw(best.value) > decodeDraw(A)) {
                                     type = ExploredPositionType::EXACT;
@@ -144,18 +362,69 @@ private:
                                 }
                             }
                         }
+
+                        // no move reached the stored alpha
+                        else if (pos->type == ExploredPositionType::UPPER) {
+                            if (decodeDraw(hashMove.value) <= decodeDraw(A)) {
+                                setPv(depth, hashMove.move, false);
+                                return hashMove;
+                            }
+                        }
                     }
                 }
                 // this should not happen
                 else {
                     std::cerr << "A TRANSPOSITION TABLE COLLISION MADE IT RETURN AN IMPOSSIBLE MOVE" << std::endl;
                     pos = nullptr;
+                    hashMove.move = Move::end;
+                }
+            }
+            // ProbCut: a shallow search that fails out of the window by a margin predicts the deep one does
+            // (before the moves of this depth are generated, the shallow search uses them)
+            if (probCut.enabled && depth > 0 && maxDepth - depth >= PROBCUT_MIN_DEPTH && board.nonesSum() >= PROBCUT_MIN_NONES
+                    && isHeuristicScore(A) && isHeuristicScore(B)) {
+                const int shallowMaxDepth = maxDepth - PROBCUT_REDUCTION;
+
+                const score_t high = probCut.shallowBound(B, 1);
+                const MoveValued above = negamax<Player, Free>(board, depth, shallowMaxDepth, high-1, high);
+                if (decodeDraw(above.value) >= high) {
+                    return {above.move, B};
                 }
+
+                const score_t low = probCut.shallowBound(A, -1);
+                const MoveValued below = negamax<Player, Free>(board, depth, shallowMaxDepth, low, low+1);
+                if (decodeDraw(below.value) <= low) {
+                    return {below.move, A};
+                }
+            }
+
+            // internal iterative deepening: the best move of a shallower search (stored in the table by it) is searched first
+            if (hashMove.move == Move::end && !restricted && maxDepth - depth >= IID_MIN_DEPTH) {
+                hashMove.move = negamax<Player, Free>(board, depth, maxDepth - IID_REDUCTION, A, B).move;
             }
+
             // generate moves
-            board.possibleMoves(moves[depth], movesGenerator[depth]);
+            PROFILE_START(generation);
+            board.possibleMoves<Free>(moves[depth], movesGenerator[depth]);
+            PROFILE_STOP(generation, maxDepth - depth, MOVE_GENERATION);
+
+            // enhanced transposition cutoff: a child already searched deep enough may refute the parent
+            if (!restricted && maxDepth - depth >= ETC_MIN_DEPTH) {
+                PROFILE_START(etc);
+                const MoveValued refutation = transpositionCutoff<Player>(board, depth, maxDepth, B);
+                PROFILE_STOP(etc, maxDepth - depth, TABLE_PROBE);
+
+                if (refutation.move != Move::end) {
+                    best = refutation;
+                    setPv(depth, best.move, false);
+                    type = ExploredPositionType::LOWER;
+                    A = best.value;
+                    goto return_pos;
+                }
+            }
 
             // order moves
+            PROFILE_START(ordering);
             bool found = false;
             int nbMoves = 0;
             for (MoveValued& mv : moves[depth]) {
@@ -165,7 +434,7 @@ private:
                 nbMoves++;
 
                 // there was a hashmove corresponding to the current position and we found it in the possible moves
-                if (pos != nullptr && mv.move == hashMove.move) {
+                if (hashMove.move != Move::end && mv.move == hashMove.move) {
                     found = true;
                     std::swap(moves[depth][0].move, mv.move); // relevant hashmove is checked first
                 }
@@ -174,30 +443,41 @@ private:
                 else {
                     const auto ttt1 = board.get_ttt(mv.move.Y(), mv.move.X());
                     auto ttt2 = ttt1;
-                    set_ttt_int(ttt2, mv.move.y(), mv.move.x(), player);
-                    mv.value = ((player == Owner::Player0) ? 1 : -1) * scoring.score(ttt2, player);
+                    set_ttt_int(ttt2, mv.move.y(), mv.move.x(), Player);
+                    const ttt_t destination = (mv.move.yx() == mv.move.YX()) ? ttt2 : board.getBoard()[mv.move.yx()];
+                    mv.value = scoring.score(ttt2, Player) + destinationTerms()[2*destination + OTHER(Player) - 1];
                 }
             }
 
             std::sort(moves[depth].begin() + (found ? 1 : 0), moves[depth].begin() + nbMoves,
                 [](const MoveValued& m1, const MoveValued& m2){ return m1.value > m2.value; });
+            PROFILE_STOP(ordering, maxDepth - depth, ORDERING);
 
             // for every possible move
+            int searched = 0;
             for (const MoveValued& mv : moves[depth]) {
                 if (mv.move == Move::end) break;
                 if (mv.move == Move::skip) continue;
+                if (restricted && std::find(excludedRootMoves.begin(), excludedRootMoves.end(), mv.move) != excludedRootMoves.end()) continue;
+                searched++;
 
-                board.action(mv.move, player);
-
-                movesGenerator[depth+1] = board.isWonOrFull_d(mv.move.j%9) ? Move::any : mv.move;
+                PROFILE_START(make);
+                board.action(mv.move, Player);
+                const bool childFree = board.isWonOrFull_d(mv.move.j%9);
+                movesGenerator[depth+1] = childFree ? Move::any : mv.move;
+                PROFILE_STOP(make, maxDepth - depth, MAKE_UNMAKE);
 
                 MoveValued current;
                 try {
-                    current = minmax(board, depth+1, maxDepth, OTHER(player), -B, -A);
+                    current = childFree
+                        ? negamax<OTHER(Player), true>(board, depth+1, maxDepth, -B, -A)
+                        : negamax<OTHER(Player), false>(board, depth+1, maxDepth, -B, -A);
                 }
                 catch (int) { board.cancel(); throw; }
 
+                PROFILE_START(unmake);
                 board.cancel();
+                PROFILE_STOP(unmake, maxDepth - depth, MAKE_UNMAKE);
 
                 if (!isDraw(current.value)) {
                     current.value *= -1; // negamax
@@ -206,6 +486,7 @@ private:
                 if (decodeDraw(current.value) > decodeDraw(best.value)) {
                     best.value = current.value;
                     best.move = mv.move;
+                    setPv(depth, mv.move, true);
 
                     if (decodeDraw(best.value) > decodeDraw(A)) {
                         type = ExploredPositionType::EXACT;
@@ -213,6 +494,8 @@ private:
 
                         if (decodeDraw(A) >= decodeDraw(B)) { // alpha beta pruning
                             type = ExploredPositionType::LOWER;
+                            cutoffs++;
+                            firstMoveCutoffs += (searched == 1);
                             break;
                         }
                     }
@@ -222,24 +505,97 @@ private:
         return_pos:
 
         // save position in transposition table
-        if (type != ExploredPositionType::UPPER && (maxDepth - depth) >= TABLE_CUTOFF) {
+        if ((maxDepth - depth) >= TABLE_CUTOFF && !(depth == 0 && !excludedRootMoves.empty())) {
             ExploredPosition pos;
             pos.type = type;
             pos.depthBelow = maxDepth - depth;
-            pos.fullMoves = (movesGenerator[depth] == Move::any);
+            pos.fullMoves = Free;
             pos.bestMove = best.move.j;
-            pos.player = encodePlayerAsBool(player);
+            pos.player = encodePlayerAsBool(Player);
             pos.value = A;
 
+            PROFILE_START(store);
             ttable.put(board.getBoard(), pos);
+            PROFILE_STOP(store, maxDepth - depth, TABLE_STORE);
         }
 
         return best;
     }
 
+    /**
+     * The ordering term of sending the opponent to play in a sub-board, by sub-board and opponent (computed once).
+     * A free move gives them up to 81 replies, hence the penalty. Measured on self-play positions, sending them
+     * where they can win the sub-board at once is on the contrary worth trying early (forcing lines, smaller trees),
+     * and their Scoring value of the other sub-boards did not help the ordering.
+     */
+    static const std::vector<int8_t>& destinationTerms() {
+        static const std::vector<int8_t> terms = []() {
+            std::vector<int8_t> all(2*NUMBER_OF_TTT, 0);
+            for (ttt_t ttt = 0; ttt < NUMBER_OF_TTT; ttt++) {
+                const bool wonOrFull = win(ttt, Owner::Player0) || win(ttt, Owner::Player1) || nones(ttt) == 0;
+                for (player_t opponent : {Owner::Player0, Owner::Player1}) {
+                    if (wonOrFull) {
+                        all[2*ttt + opponent - 1] = -FREE_MOVE_PENALTY;
+                    }
+                    else if (number_of_ways_to_win(ttt, opponent) > 0) {
+                        all[2*ttt + opponent - 1] = WIN_IN_ONE_BONUS;
+                    }
+                }
+            }
+            return all;
+        }();
+        return terms;
+    }
+
+    /// neither a draw nor a win or loss, nor the initial bounds of the window
+    static inline bool isHeuristicScore(score_t score) {
+        return !isDraw(score) && std::abs(score) <= PROBCUT_MAX_BOUND;
+    }
+
+    /// a move whose child is stored in the table with an exact value or an upper bound (from enough depth)
+    /// of at least B for Player, with that value; Move::end when there is none
+    template<player_t Player>
+    MoveValued transpositionCutoff(Board& board, int depth, int maxDepth, score_t B) {
+        for (const MoveValued& mv : moves[depth]) {
+            if (mv.move == Move::end) break;
+            if (mv.move == Move::skip) continue;
+
+            board.action(mv.move, Player);
+            const Move generator = board.isWonOrFull_d(mv.move.yx()) ? Move::any : mv.move;
+            const ExploredPosition* child = (board.winner() == Owner::None)
+                ? ttable.get(board.getBoard(), OTHER(Player), generator)
+                : nullptr;
+            const bool relevant = child != nullptr && (child->type == ExploredPositionType::EXACT || child->type == ExploredPositionType::UPPER)
+                && child->depthBelow >= maxDepth - depth - 1 && board.isValidMove(generator, child->bestMove);
+            board.cancel();
+
+            if (relevant) {
+                const score_t value = isDraw(child->value) ? child->value : -child->value;
+                if (decodeDraw(value) >= decodeDraw(B)) {
+                    return {mv.move, value};
+                }
+            }
+        }
+        return {Move::end, 0};
+    }
+
+    /// the principal variation of depth is move, followed by the one of depth+1 when it was just searched
+    inline void setPv(int depth, Move move, bool withChild) {
+        pvTable[depth][depth] = move;
+        pvLength[depth] = depth+1;
+
+        if (withChild) {
+            for (int i = depth+1; i < pvLength[depth+1]; i++) {
+                pvTable[depth][i] = pvTable[depth+1][i];
+            }
+            pvLength[depth] = std::max(pvLength[depth+1], depth+1);
+        }
+    }
+
 private:
     TranspositionTable<TableSize> ttable;
-    const Scoring& scoring;
+    const Evaluator& scoring;
+    Accumulator accumulator; // first layer of the network followed by the board, when Evaluator has one
 
     // these are used to avoid allocations for the moves to explore
     std::array<Move, MAX_DEPTH+1> movesGenerator; // move of the previous level
@@ -248,8 +604,32 @@ private:
     double timeBudget;
 	std::chrono::time_point<std::chrono::steady_clock> start;
 
+    // triangular array: the principal variation found at depth is pvTable[depth][depth..pvLength[depth])
+    std::array<std::array<Move, MAX_DEPTH+1>, MAX_DEPTH+1> pvTable;
+    std::array<int, MAX_DEPTH+2> pvLength;
+
     int maxDepth;
+    int depthLimit;
+    bool verbose = true;
+    long positionsLimit = 0;
+
+    int multiPv = 1;
+    std::vector<Move> excludedRootMoves;
+    const std::atomic<bool>* stopFlag = nullptr;
+    InfoCallback infoCallback;
+
+    long previousExploredPositions;
+    long exploredPositions;
+
+    ProbCutParameters probCut;
+
+    TelemetrySink* telemetry = nullptr;
+    const char* abortReason; // of the last search, nullptr when not aborted
+    long previousIterationNodes = 0;
+    long cutoffs = 0; // beta cutoffs in the move loop
+    long firstMoveCutoffs = 0; // the ones on the first move searched
 
-    int previousExploredPositions;
-    int exploredPositions;
+#ifdef SEARCH_PROFILER
+    SearchProfiler profiler; // of the current play()
+#endif
 };
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "common/types.h"
+#include "common/global_score.h"
+#include "common/board.h"
+#include "common/accumulator.h"
+#include "score.h"
+
+#define NNUE_HIDDEN2 (32) // width of the second layer
+
+#define NNUE_ACTIVATION_MAX (127) // 1.0 once clipped, activations fit in uint8
+#define NNUE_WEIGHT_SHIFT (6) // hidden and output weights are quantized so that 1.0 is 64
+#define NNUE_OUTPUT_SCALE (1024) // score of a position whose network output (a logit) is 1.0
+#define NNUE_MAX_SCORE (GLOBAL_VICTORY0_SCORE/2) // far from victories and from DRAW_SCORE
+
+#define NNUE_MAGIC "UTTTNNUE"
+#define NNUE_VERSION (1)
+
+/**
+ * Quantized network: 162 inputs -> NNUE_HIDDEN -> NNUE_HIDDEN2 -> 1, with clipped ReLU between layers.
+ * The first layer lives in the Accumulator of the board, the others run in int8/int16 AVX2 arithmetic.
+ *
+ * The weights file (written by train_nnue.py) is little-endian: the magic, the version, the 3 layer sizes
+ * as uint32, then int16 first layer biases and weights (feature major), int8 second layer weights
+ * (output major), int32 second layer biases, int16 output weights and the int32 output bias.
+ */
+struct NnueNetwork {
+	FeatureWeights features;
+	std::array<std::array<int8_t, NNUE_HIDDEN>, NNUE_HIDDEN2> hiddenWeights;
+	std::array<int32_t, NNUE_HIDDEN2> hiddenBias;
+	std::array<int16_t, NNUE_HIDDEN2> outputWeights;
+	int32_t outputBias;
+
+	bool load(const std::string& path) {
+		std::ifstream in(path, std::ios::binary);
+
+		char magic[8];
+		uint32_t header[4];
+		in.read(magic, sizeof(magic));
+		in.read((char*) header, sizeof(header));
+		if (!in || std::memcmp(magic, NNUE_MAGIC, sizeof(magic)) != 0 || header[0] != NNUE_VERSION
+			|| header[1] != NNUE_FEATURES || header[2] != NNUE_HIDDEN || header[3] != NNUE_HIDDEN2) {
+			return false;
+		}
+
+		in.read((char*) features.bias.data(), sizeof(features.bias));
+		in.read((char*) features.weights.data(), sizeof(features.weights));
+		in.read((char*) hiddenWeights.data(), sizeof(hiddenWeights));
+		in.read((char*) hiddenBias.data(), sizeof(hiddenBias));
+		in.read((char*) outputWeights.data(), sizeof(outputWeights));
+		in.read((char*) &outputBias, sizeof(outputBias));
+		return (bool) in;
+	}
+
+	/// network output in score units, from the point of view of Player0
+	score_t evaluate(const Accumulator::Values& accumulator) const {
+		const int32_t output = hasAVX2() ? forwardAVX2(accumulator) : forwardScalar(accumulator);
+
+		// output is quantized with 1.0 = NNUE_ACTIVATION_MAX << NNUE_WEIGHT_SHIFT
+		const int32_t score = (int64_t) output * NNUE_OUTPUT_SCALE / (NNUE_ACTIVATION_MAX << NNUE_WEIGHT_SHIFT);
+		return std::max(-NNUE_MAX_SCORE, std::min(NNUE_MAX_SCORE, score));
+	}
+
+	int32_t forwardScalar(const Accumulator::Values& accumulator) const {
+		std::array<int32_t, NNUE_HIDDEN> a1;
+		for (int i = 0; i < NNUE_HIDDEN; i++) {
+			a1[i] = clip(accumulator[i]);
+		}
+
+		int32_t output = outputBias;
+		for (int j = 0; j < NNUE_HIDDEN2; j++) {
+			int32_t sum = hiddenBias[j];
+			for (int i = 0; i < NNUE_HIDDEN; i++) {
+				sum += a1[i] * hiddenWeights[j][i];
+			}
+			output += clip(sum >> NNUE_WEIGHT_SHIFT) * outputWeights[j];
+		}
+		return output;
+	}
+
+	__attribute__((target("avx2")))
+	int32_t forwardAVX2(const Accumulator::Values& accumulator) const {
+		static_assert(NNUE_HIDDEN == 64 && NNUE_HIDDEN2 == 32, "the AVX2 kernel is written for 64 -> 32 -> 1");
+
+		// clipped ReLU of the accumulator packed as 64 uint8 (packus shuffles 64 bits lanes, permute restores them)
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max = _mm256_set1_epi16(NNUE_ACTIVATION_MAX);
+		__m256i a[2];
+		for (int k = 0; k < 2; k++) {
+			const __m256i lo = _mm256_loadu_si256((const __m256i*) &accumulator[32*k]);
+			const __m256i hi = _mm256_loadu_si256((const __m256i*) &accumulator[32*k + 16]);
+			const __m256i packed = _mm256_packus_epi16(_mm256_min_epi16(lo, max), _mm256_min_epi16(hi, max));
+			a[k] = _mm256_permute4x64_epi64(packed, 0b11011000);
+		}
+
+		// second layer: uint8 x int8 products summed by 2 into int16 then by 4 into int32, 8 outputs at a time
+		const __m256i ones = _mm256_set1_epi16(1);
+		alignas(32) std::array<int32_t, NNUE_HIDDEN2> sums;
+		for (int j = 0; j < NNUE_HIDDEN2; j += 8) {
+			__m256i s[8];
+			for (int k = 0; k < 8; k++) {
+				const __m256i* w = (const __m256i*) hiddenWeights[j+k].data();
+				const __m256i p0 = _mm256_maddubs_epi16(a[0], _mm256_loadu_si256(w));
+				const __m256i p1 = _mm256_maddubs_epi16(a[1], _mm256_loadu_si256(w + 1));
+				s[k] = _mm256_add_epi32(_mm256_madd_epi16(p0, ones), _mm256_madd_epi16(p1, ones));
+			}
+			// horizontal sums of the 8 registers into one register of 8 int32
+			const __m256i s01 = _mm256_hadd_epi32(s[0], s[1]);
+			const __m256i s23 = _mm256_hadd_epi32(s[2], s[3]);
+			const __m256i s45 = _mm256_hadd_epi32(s[4], s[5]);
+			const __m256i s67 = _mm256_hadd_epi32(s[6], s[7]);
+			const __m256i s0123 = _mm256_hadd_epi32(s01, s23);
+			const __m256i s4567 = _mm256_hadd_epi32(s45, s67);
+			const __m256i sum = _mm256_add_epi32(
+				_mm256_permute2x128_si256(s0123, s4567, 0x20),
+				_mm256_permute2x128_si256(s0123, s4567, 0x31));
+			const __m256i biased = _mm256_add_epi32(sum, _mm256_loadu_si256((const __m256i*) &hiddenBias[j]));
+			_mm256_storeu_si256((__m256i*) &sums[j], _mm256_srai_epi32(biased, NNUE_WEIGHT_SHIFT));
+		}
+
+		// clipped ReLU and output layer in int16
+		const __m256i s0 = _mm256_packs_epi32(_mm256_loadu_si256((const __m256i*) &sums[0]), _mm256_loadu_si256((const __m256i*) &sums[8]));
+		const __m256i s1 = _mm256_packs_epi32(_mm256_loadu_si256((const __m256i*) &sums[16]), _mm256_loadu_si256((const __m256i*) &sums[24]));
+		const __m256i a0 = _mm256_permute4x64_epi64(_mm256_max_epi16(_mm256_min_epi16(s0, max), zero), 0b11011000);
+		const __m256i a1 = _mm256_permute4x64_epi64(_mm256_max_epi16(_mm256_min_epi16(s1, max), zero), 0b11011000);
+		const __m256i o = _mm256_add_epi32(
+			_mm256_madd_epi16(a0, _mm256_loadu_si256((const __m256i*) &outputWeights[0])),
+			_mm256_madd_epi16(a1, _mm256_loadu_si256((const __m256i*) &outputWeights[16])));
+		const __m128i o4 = _mm_add_epi32(_mm256_castsi256_si128(o), _mm256_extracti128_si256(o, 1));
+		const __m128i o2 = _mm_add_epi32(o4, _mm_unpackhi_epi64(o4, o4));
+		const __m128i o1 = _mm_add_epi32(o2, _mm_shuffle_epi32(o2, 1));
+		return outputBias + _mm_cvtsi128_si32(o1);
+	}
+
+	static inline int32_t clip(int32_t x) {
+		return std::max(0, std::min(NNUE_ACTIVATION_MAX, x));
+	}
+
+	static bool hasAVX2() {
+		static const bool avx2 = __builtin_cpu_supports("avx2");
+		return avx2;
+	}
+};
+
+/**
+ * Evaluation by the network, usable instead of Scoring by MinMaxBasedAI.
+ * Move ordering keeps the hand-crafted sub-board scores.
+ */
+class NnueScoring {
+public:
+	NnueScoring(const NnueNetwork& network) : network(network) {
+	}
+
+	inline score_t score(ttt_t ttt, player_t player) const {
+		return scoring.score(ttt, player);
+	}
+
+	inline score_t score(const Board& board) const {
+		if (board.winner() != Owner::None)
+			return scoring.score(board);
+
+		const Accumulator* accumulator = board.getAccumulator();
+		if (accumulator == nullptr) {
+			Accumulator fresh;
+			fresh.use(network.features);
+			fresh.refresh(board.getBoard());
+			return network.evaluate(fresh.current());
+		}
+		return network.evaluate(accumulator->current());
+	}
+
+	/// the search will only evaluate board after this call
+	void attach(Board& board, Accumulator& accumulator) const {
+		accumulator.use(network.features);
+		board.attach(&accumulator);
+	}
+
+private:
+	const NnueNetwork& network;
+	const Scoring scoring;
+};
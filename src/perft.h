@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+#include "wyhash/wyhash.h"
+
+#include "common/move.h"
+#include "common/board.h"
+
+#define PERFT_CACHE_SIZE (1 << 22) // default number of entries of the perft hash cache
+#define PERFT_CACHE_MIN_DEPTH (3) // smaller subtrees are cheaper to count than to hash
+#define PERFT_DEPTH_BITS (8)
+#define PERFT_MAX_DEPTH (9*9)
+#define PERFT_KEY_MULTIPLIER (0x9E3779B97F4A7C15ull) // spreads the (sub-board, player) keys over 64 bits
+
+/**
+ * Leaf counts of already explored subtrees, shared by the threads without locks:
+ * an entry stores key^data next to data, a torn write is seen as a key mismatch.
+ */
+class PerftCache {
+public:
+    PerftCache(size_t size) : entries(size) {
+        for (Entry& entry : entries) {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline bool get(uint64_t key, int depth, uint64_t& count) const {
+        const Entry& entry = entries[key % entries.size()];
+        const uint64_t data = entry.data.load(std::memory_order_relaxed);
+        const uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+        if ((check ^ data) != key || (int) (data & ((1 << PERFT_DEPTH_BITS) - 1)) != depth)
+            return false;
+
+        count = data >> PERFT_DEPTH_BITS;
+        return true;
+    }
+
+    inline void put(uint64_t key, int depth, uint64_t count) {
+        Entry& entry = entries[key % entries.size()];
+        const uint64_t data = (count << PERFT_DEPTH_BITS) | depth;
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data; // leaf count << PERFT_DEPTH_BITS | depth
+    };
+
+    std::vector<Entry> entries;
+};
+
+/**
+ * Counts the leaves of the game tree to a fixed depth, to check and measure the move generation
+ * (Board::possibleMoves, action and cancel). Positions where the game is over have no leaves below.
+ * The normalized board, the move generator and the player define the subtree, so transpositions
+ * share their counts in the cache.
+ */
+class Perft {
+public:
+    /// bulk counts the moves of the last ply instead of playing them, cacheSize 0 disables the cache
+    Perft(bool bulk = true, size_t cacheSize = PERFT_CACHE_SIZE) : bulk(bulk) {
+        if (cacheSize > 0) {
+            cache.reset(new PerftCache(cacheSize));
+        }
+    }
+
+    /// leaf count below each root move, the root moves are split between nbThreads threads
+    uint64_t run(const Board& board, const Move& moveGenerator, player_t player, int depth, int nbThreads,
+            std::array<uint64_t, 9*9>& divide) {
+        divide.fill(0);
+        actions.store(0, std::memory_order_relaxed);
+
+        if (depth == 0) {
+            return 1;
+        }
+        if (board.isOver()) {
+            return 0;
+        }
+
+        std::array<MoveValued, 9*9+1> moves;
+        board.possibleMoves(moves, moveGenerator);
+        int nbMoves = 0;
+        while (moves[nbMoves].move != Move::end) {
+            nbMoves++;
+        }
+
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            Board local = board;
+            std::array<std::array<MoveValued, 9*9+1>, PERFT_MAX_DEPTH+1> localMoves;
+            uint64_t localActions = 0;
+
+            for (int i = next++; i < nbMoves; i = next++) {
+                const Move move = moves[i].move;
+                local.action(move, player);
+                localActions++;
+                const Move nextGenerator = local.isWonOrFull_d(move.yx()) ? Move::any : move;
+                divide[move.j] = count(local, nextGenerator, OTHER(player), depth-1, localMoves, localActions);
+                local.cancel();
+            }
+            actions.fetch_add(localActions, std::memory_order_relaxed);
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < nbThreads; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        uint64_t total = 0;
+        for (uint64_t leaves : divide) {
+            total += leaves;
+        }
+        return total;
+    }
+
+    /// number of Board::action done by the last run
+    uint64_t actionsCount() const {
+        return actions.load(std::memory_order_relaxed);
+    }
+
+private:
+    uint64_t count(Board& board, const Move& moveGenerator, player_t player, int depth,
+            std::array<std::array<MoveValued, 9*9+1>, PERFT_MAX_DEPTH+1>& moves, uint64_t& actionsCount) {
+        if (depth == 0) {
+            return 1;
+        }
+        if (board.isOver()) {
+            return 0;
+        }
+
+        uint64_t key = 0;
+        if (cache && depth >= PERFT_CACHE_MIN_DEPTH) {
+            // wyhash xors its seed with the first sub-board, so the seed can't tell the generator and player apart
+            const uint64_t forced = (moveGenerator == Move::any) ? 9 : moveGenerator.yx();
+            key = wyhash(board.getBoard().data(), board.getBoard().size() * sizeof(ttt_t), 0)
+                ^ ((forced*2 + encodePlayerAsBool(player) + 1) * PERFT_KEY_MULTIPLIER);
+            uint64_t cached;
+            if (cache->get(key, depth, cached)) {
+                return cached;
+            }
+        }
+
+        auto& possible = moves[depth];
+        board.possibleMoves(possible, moveGenerator);
+
+        uint64_t leaves = 0;
+        if (bulk && depth == 1) {
+            while (possible[leaves].move != Move::end) {
+                leaves++;
+            }
+            return leaves;
+        }
+
+        for (const MoveValued& mv : possible) {
+            if (mv.move == Move::end) break;
+
+            board.action(mv.move, player);
+            actionsCount++;
+            const Move nextGenerator = board.isWonOrFull_d(mv.move.yx()) ? Move::any : mv.move;
+            leaves += count(board, nextGenerator, OTHER(player), depth-1, moves, actionsCount);
+            board.cancel();
+        }
+
+        if (cache && depth >= PERFT_CACHE_MIN_DEPTH) {
+            cache->put(key, depth, leaves);
+        }
+        return leaves;
+    }
+
+private:
+    const bool bulk;
+    std::unique_ptr<PerftCache> cache;
+
+    std::atomic<uint64_t> actions;
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "common/board.h"
+#include "common/move.h"
+
+#define PLAYOUT_VECTORS (2) // number of AVX2 registers of games advanced together
+#define PLAYOUT_LANES (8*PLAYOUT_VECTORS) // games played by one call
+
+#define FREE_SUB_BOARD (9) // forced sub-board value when any sub-board can be played
+
+#define CELLS_MASK (0x1FF)
+#define PLAYER1_SHIFT (16)
+
+/// 3-in-a-row masks of a sub-board where each cell is one bit (same lines as LINES_OF_PLAYER0)
+constexpr uint32_t LINES_OF_CELLS[] = {
+    // lines
+    0b000000111,
+    0b000111000,
+    0b111000000,
+    // columns
+    0b001001001,
+    0b010010010,
+    0b100100100,
+    // diagonals
+    0b100010001,
+    0b001010100,
+};
+
+/** Bit position of the n-th set bit of a 9 bits mask, at index mask*9 + n */
+class PrecomputedNthBit {
+public:
+    PrecomputedNthBit() {
+        for (int mask = 0; mask <= CELLS_MASK; mask++) {
+            int n = 0;
+            for (int bit = 0; bit < 9; bit++) {
+                _nthBit[mask*9 + bit] = 0;
+            }
+            for (int bit = 0; bit < 9; bit++) {
+                if (mask & (1 << bit)) {
+                    _nthBit[mask*9 + n++] = bit;
+                }
+            }
+        }
+    }
+
+    inline int nthBit(uint32_t mask, uint32_t n) const {
+        return _nthBit[mask*9 + n];
+    }
+
+    inline const int* data() const {
+        return _nthBit.data();
+    }
+
+private:
+    std::array<int, (CELLS_MASK+1)*9> _nthBit;
+};
+
+const PrecomputedNthBit precomputedNthBit;
+
+/** Games in structure-of-arrays layout, lane i of every array is game i.
+  * A sub-board is one word: bits 0-8 are the cells of Owner::Player0, bits 16-24 the cells of Owner::Player1.
+  */
+struct alignas(32) PlayoutLanes {
+    std::array<std::array<uint32_t, PLAYOUT_LANES>, 9> cells;
+    std::array<uint32_t, PLAYOUT_LANES> macro; // won sub-boards, same layout as cells
+    std::array<uint32_t, PLAYOUT_LANES> closed; // won or full sub-boards
+    std::array<uint32_t, PLAYOUT_LANES> forced; // sub-board to play in, or FREE_SUB_BOARD
+    std::array<uint32_t, PLAYOUT_LANES> winner; // Owner::None while the game is running
+    std::array<uint32_t, PLAYOUT_LANES> rng; // xorshift32 state
+};
+
+/** Plays PLAYOUT_LANES uniformly random games at once from the same position.
+  * The AVX2 kernel and the scalar reference draw the same random numbers, so they play the same games.
+  */
+class PlayoutEngine {
+public:
+    PlayoutEngine(uint32_t seed) {
+        // splitmix32, xorshift32 must never be seeded with 0
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++) {
+            uint32_t z = (seed += 0x9E3779B9);
+            z = (z ^ (z >> 16)) * 0x85EBCA6B;
+            z = (z ^ (z >> 13)) * 0xC2B2AE35;
+            z ^= z >> 16;
+            lanes.rng[lane] = (z != 0) ? z : 1;
+        }
+    }
+
+    /// winners[lane] is the Owner of the game played in lane
+    void run(const Board& board, player_t player, const Move& moveGenerator, std::array<player_t, PLAYOUT_LANES>& winners) {
+        load(board, moveGenerator);
+        if (hasAVX2()) {
+            runAVX2(player);
+        }
+        else {
+            runScalar(player);
+        }
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++) {
+            winners[lane] = lanes.winner[lane];
+        }
+    }
+
+    void load(const Board& board, const Move& moveGenerator) {
+        const auto& ttts = board.getBoard();
+
+        uint32_t macro = 0;
+        uint32_t closed = 0;
+        std::array<uint32_t, 9> cells;
+        for (int k = 0; k < 9; k++) {
+            cells[k] = 0;
+            for (int i = 0; i < 9; i++) {
+                const auto c = get_ttt_int(ttts[k], i);
+                if (c == Owner::Player0) cells[k] |= 1 << i;
+                if (c == Owner::Player1) cells[k] |= 1 << (i + PLAYER1_SHIFT);
+            }
+
+            if (win(ttts[k], Owner::Player0)) macro |= 1 << k;
+            if (win(ttts[k], Owner::Player1)) macro |= 1 << (k + PLAYER1_SHIFT);
+            if (board.isWonOrFull_d(k)) closed |= 1 << k;
+        }
+
+        startCells = cells;
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++) {
+            for (int k = 0; k < 9; k++) {
+                lanes.cells[k][lane] = cells[k];
+            }
+            lanes.macro[lane] = macro;
+            lanes.closed[lane] = closed;
+            lanes.forced[lane] = (moveGenerator == Move::any) ? FREE_SUB_BOARD : moveGenerator.yx();
+            lanes.winner[lane] = board.winner();
+        }
+    }
+
+    /** Scalar reference of the kernel, history[lane] receives the moves played (Move::end terminated) */
+    void runScalar(player_t player, std::array<std::array<Move, 9*9+1>, PLAYOUT_LANES>* history = nullptr) {
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++) {
+            player_t p = player;
+            int ply = 0;
+
+            while (lanes.winner[lane] == Owner::None) {
+                const int shift = (p == Owner::Player0) ? 0 : PLAYER1_SHIFT;
+                const uint32_t forced = lanes.forced[lane];
+
+                std::array<uint32_t, 9> empty;
+                uint32_t total = 0;
+                for (int k = 0; k < 9; k++) {
+                    const uint32_t cells = lanes.cells[k][lane];
+                    const bool allowed = (forced == (uint32_t) k || forced == FREE_SUB_BOARD) && !(lanes.closed[lane] & (1 << k));
+                    empty[k] = allowed ? (~(cells | (cells >> PLAYER1_SHIFT)) & CELLS_MASK) : 0;
+                    total += __builtin_popcount(empty[k]);
+                }
+
+                uint32_t r = (xorshift(lanes.rng[lane]) >> 16) * total >> 16;
+                int k = 0;
+                while (r >= (uint32_t) __builtin_popcount(empty[k])) {
+                    r -= __builtin_popcount(empty[k]);
+                    k++;
+                }
+                const int cell = precomputedNthBit.nthBit(empty[k], r);
+
+                if (history != nullptr) {
+                    (*history)[lane][ply++] = Move(k*9 + cell);
+                }
+
+                uint32_t& sub = lanes.cells[k][lane];
+                sub |= 1 << (cell + shift);
+
+                const uint32_t mine = (sub >> shift) & CELLS_MASK;
+                const bool won = isLine(mine);
+                const bool full = ((sub | (sub >> PLAYER1_SHIFT)) & CELLS_MASK) == CELLS_MASK;
+                if (won) lanes.macro[lane] |= 1 << (k + shift);
+                if (won || full) lanes.closed[lane] |= 1 << k;
+
+                if (isLine((lanes.macro[lane] >> shift) & CELLS_MASK))
+                    lanes.winner[lane] = p;
+                else if (lanes.closed[lane] == CELLS_MASK)
+                    lanes.winner[lane] = Owner::Draw;
+
+                lanes.forced[lane] = (lanes.closed[lane] & (1 << cell)) ? FREE_SUB_BOARD : cell;
+                p = OTHER(p);
+            }
+
+            if (history != nullptr) {
+                (*history)[lane][ply] = Move::end;
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void runAVX2(player_t player) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i cellsMask = _mm256_set1_epi32(CELLS_MASK);
+        const __m256i freeSubBoard = _mm256_set1_epi32(FREE_SUB_BOARD);
+
+        for (int v = 0; v < PLAYOUT_VECTORS; v++) {
+            __m256i cells[9];
+            for (int k = 0; k < 9; k++) {
+                cells[k] = load256(&lanes.cells[k][8*v]);
+            }
+            __m256i macro = load256(&lanes.macro[8*v]);
+            __m256i closed = load256(&lanes.closed[8*v]);
+            __m256i forced = load256(&lanes.forced[8*v]);
+            __m256i winner = load256(&lanes.winner[8*v]);
+            __m256i rng = load256(&lanes.rng[8*v]);
+
+            player_t p = player;
+            __m256i active = _mm256_cmpeq_epi32(winner, zero);
+
+            while (!_mm256_testz_si256(active, active)) {
+                const int shift = (p == Owner::Player0) ? 0 : PLAYER1_SHIFT;
+                const __m256i anySubBoard = _mm256_cmpeq_epi32(forced, freeSubBoard);
+
+                // legal cells of every sub-board and their count
+                __m256i empty[9];
+                __m256i count[9];
+                __m256i total = zero;
+                for (int k = 0; k < 9; k++) {
+                    const __m256i allowed = _mm256_andnot_si256(
+                        _mm256_cmpeq_epi32(_mm256_and_si256(closed, _mm256_set1_epi32(1 << k)), _mm256_set1_epi32(1 << k)),
+                        _mm256_or_si256(anySubBoard, _mm256_cmpeq_epi32(forced, _mm256_set1_epi32(k))));
+                    empty[k] = _mm256_and_si256(allowed,
+                        _mm256_andnot_si256(_mm256_or_si256(cells[k], _mm256_srli_epi32(cells[k], PLAYER1_SHIFT)), cellsMask));
+                    count[k] = popcount9(empty[k]);
+                    total = _mm256_add_epi32(total, count[k]);
+                }
+
+                // r in [0, total), finished games keep their generator untouched
+                __m256i x = rng;
+                x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+                x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+                x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+                rng = _mm256_blendv_epi8(rng, x, active);
+                const __m256i r = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(x, 16), total), 16);
+
+                // find the sub-board holding the r-th legal cell
+                __m256i chosen[9];
+                __m256i chosenEmpty = zero;
+                __m256i chosenIndex = zero;
+                __m256i chosenK = zero;
+                __m256i acc = zero;
+                for (int k = 0; k < 9; k++) {
+                    const __m256i next = _mm256_add_epi32(acc, count[k]);
+                    chosen[k] = _mm256_and_si256(active,
+                        _mm256_andnot_si256(_mm256_cmpgt_epi32(acc, r), _mm256_cmpgt_epi32(next, r)));
+                    chosenEmpty = _mm256_or_si256(chosenEmpty, _mm256_and_si256(chosen[k], empty[k]));
+                    chosenIndex = _mm256_or_si256(chosenIndex, _mm256_and_si256(chosen[k], _mm256_sub_epi32(r, acc)));
+                    chosenK = _mm256_or_si256(chosenK, _mm256_and_si256(chosen[k], _mm256_set1_epi32(k)));
+                    acc = next;
+                }
+                const __m256i cell = _mm256_i32gather_epi32(precomputedNthBit.data(),
+                    _mm256_add_epi32(_mm256_mullo_epi32(chosenEmpty, _mm256_set1_epi32(9)), chosenIndex), 4);
+                const __m256i bit = _mm256_sllv_epi32(one, _mm256_add_epi32(cell, _mm256_set1_epi32(shift)));
+
+                // play and look at the updated sub-board
+                __m256i sub = zero;
+                for (int k = 0; k < 9; k++) {
+                    cells[k] = _mm256_or_si256(cells[k], _mm256_and_si256(chosen[k], bit));
+                    sub = _mm256_or_si256(sub, _mm256_and_si256(chosen[k], cells[k]));
+                }
+                const __m256i won = _mm256_and_si256(active, isLine(_mm256_and_si256(_mm256_srli_epi32(sub, shift), cellsMask)));
+                const __m256i full = _mm256_and_si256(active,
+                    _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_or_si256(sub, _mm256_srli_epi32(sub, PLAYER1_SHIFT)), cellsMask), cellsMask));
+                const __m256i subBit = _mm256_sllv_epi32(one, chosenK);
+                macro = _mm256_or_si256(macro, _mm256_and_si256(won, _mm256_slli_epi32(subBit, shift)));
+                closed = _mm256_or_si256(closed, _mm256_and_si256(_mm256_or_si256(won, full), subBit));
+
+                // end of games
+                const __m256i macroWon = _mm256_and_si256(active, isLine(_mm256_and_si256(_mm256_srli_epi32(macro, shift), cellsMask)));
+                const __m256i allClosed = _mm256_andnot_si256(macroWon, _mm256_and_si256(active, _mm256_cmpeq_epi32(closed, cellsMask)));
+                winner = _mm256_or_si256(winner, _mm256_and_si256(macroWon, _mm256_set1_epi32(p)));
+                winner = _mm256_or_si256(winner, _mm256_and_si256(allClosed, _mm256_set1_epi32(Owner::Draw)));
+
+                // next sub-board
+                const __m256i cellClosed = _mm256_and_si256(_mm256_srlv_epi32(closed, cell), one);
+                const __m256i next = _mm256_blendv_epi8(cell, freeSubBoard, _mm256_cmpeq_epi32(cellClosed, one));
+                forced = _mm256_blendv_epi8(forced, next, active);
+
+                active = _mm256_andnot_si256(_mm256_or_si256(macroWon, allClosed), active);
+                p = OTHER(p);
+            }
+
+            for (int k = 0; k < 9; k++) {
+                store256(&lanes.cells[k][8*v], cells[k]);
+            }
+            store256(&lanes.macro[8*v], macro);
+            store256(&lanes.closed[8*v], closed);
+            store256(&lanes.forced[8*v], forced);
+            store256(&lanes.winner[8*v], winner);
+            store256(&lanes.rng[8*v], rng);
+        }
+    }
+
+    const PlayoutLanes& getLanes() const {
+        return lanes;
+    }
+
+    /// cells of the position the games started from, same layout as PlayoutLanes::cells
+    const std::array<uint32_t, 9>& getStartCells() const {
+        return startCells;
+    }
+
+    static bool hasAVX2() {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+private:
+    static inline uint32_t xorshift(uint32_t& x) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    static inline bool isLine(uint32_t mask) {
+        for (const uint32_t line : LINES_OF_CELLS) {
+            if ((mask & line) == line) return true;
+        }
+        return false;
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i isLine(__m256i mask) {
+        __m256i result = _mm256_setzero_si256();
+        for (const uint32_t line : LINES_OF_CELLS) {
+            const __m256i l = _mm256_set1_epi32(line);
+            result = _mm256_or_si256(result, _mm256_cmpeq_epi32(_mm256_and_si256(mask, l), l));
+        }
+        return result;
+    }
+
+    // population count of masks smaller than 2^16
+    __attribute__((target("avx2")))
+    static inline __m256i popcount9(__m256i v) {
+        v = _mm256_sub_epi32(v, _mm256_and_si256(_mm256_srli_epi32(v, 1), _mm256_set1_epi32(0x5555)));
+        v = _mm256_add_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0x3333)), _mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi32(0x3333)));
+        v = _mm256_and_si256(_mm256_add_epi32(v, _mm256_srli_epi32(v, 4)), _mm256_set1_epi32(0x0F0F));
+        return _mm256_and_si256(_mm256_add_epi32(v, _mm256_srli_epi32(v, 8)), _mm256_set1_epi32(0x1F));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i load256(const uint32_t* p) {
+        return _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    __attribute__((target("avx2")))
+    static inline void store256(uint32_t* p, __m256i v) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+private:
+    PlayoutLanes lanes;
+    std::array<uint32_t, 9> startCells;
+};
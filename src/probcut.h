@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/types.h"
+#include "common/global_score.h"
+
+#define PROBCUT_MIN_DEPTH (6) // remaining depth from which a node is tried
+#define PROBCUT_REDUCTION (4) // depth of the shallow search = remaining depth - PROBCUT_REDUCTION
+#define PROBCUT_MIN_NONES (30) // free cells under which (the endgame) it is off
+#define PROBCUT_MAX_BOUND (GLOBAL_VICTORY0_SCORE - 9*9 - 1) // below the scores of wins
+#define NB_PROBCUT_PARAMETERS (4)
+
+/**
+ * The deep score of a position is predicted as slope * shallow + intercept, with an error of standard deviation sigma.
+ * A node is cut when the shallow search predicts a fail high (or low) with threshold sigmas of margin.
+ * Fitted by main_probcut, disabled until loaded.
+ */
+struct ProbCutParameters {
+    bool enabled = false;
+    double slope = 1;
+    double intercept = 0;
+    double sigma = 0;
+    double threshold = 1.5;
+
+    static const char* name(int i) {
+        static const char* names[NB_PROBCUT_PARAMETERS] = {"slope", "intercept", "sigma", "threshold"};
+        return names[i];
+    }
+
+    /// a "name value" line per parameter, false on a missing or unknown one
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        std::vector<double*> values = {&slope, &intercept, &sigma, &threshold};
+        std::vector<bool> found(NB_PROBCUT_PARAMETERS, false);
+        std::string key;
+        double value;
+        while (in >> key >> value) {
+            int i = 0;
+            while (i < NB_PROBCUT_PARAMETERS && key != name(i)) {
+                i++;
+            }
+            if (i == NB_PROBCUT_PARAMETERS) {
+                return false;
+            }
+            *values[i] = value;
+            found[i] = true;
+        }
+        enabled = std::all_of(found.begin(), found.end(), [](bool f) { return f; }) && slope > 0;
+        return enabled;
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path);
+        const double values[NB_PROBCUT_PARAMETERS] = {slope, intercept, sigma, threshold};
+        for (int i = 0; i < NB_PROBCUT_PARAMETERS; i++) {
+            out << name(i) << ' ' << values[i] << std::endl;
+        }
+        return (bool) out;
+    }
+
+    /// the shallow score from which the deep one is predicted at least bound (side 1) or at most bound (side -1)
+    score_t shallowBound(score_t bound, int side) const {
+        const double shallow = (decodeDraw(bound) + side * threshold * sigma - intercept) / slope;
+        const double rounded = (side > 0) ? std::ceil(shallow) : std::floor(shallow);
+        return (score_t) std::max<double>(-PROBCUT_MAX_BOUND, std::min<double>(PROBCUT_MAX_BOUND, rounded));
+    }
+};
+
+/// least squares fit of the deep scores on the shallow ones
+class ProbCutCalibration {
+public:
+    void add(score_t shallow, score_t deep) {
+        pairs.push_back({shallow, deep});
+    }
+
+    size_t size() const {
+        return pairs.size();
+    }
+
+    /// the threshold is kept, false with too few or constant shallow scores
+    bool fit(ProbCutParameters& parameters) const {
+        const double n = pairs.size();
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (const auto& pair : pairs) {
+            sx += pair.first;
+            sy += pair.second;
+            sxx += (double) pair.first * pair.first;
+            sxy += (double) pair.first * pair.second;
+        }
+        const double variance = n * sxx - sx * sx;
+        if (n < 2 || variance <= 0) {
+            return false;
+        }
+
+        parameters.slope = (n * sxy - sx * sy) / variance;
+        parameters.intercept = (sy - parameters.slope * sx) / n;
+
+        double squares = 0;
+        for (const auto& pair : pairs) {
+            const double error = pair.second - (parameters.slope * pair.first + parameters.intercept);
+            squares += error * error;
+        }
+        parameters.sigma = std::sqrt(squares / n);
+        parameters.enabled = parameters.slope > 0;
+        return parameters.enabled;
+    }
+
+private:
+    std::vector<std::pair<score_t, score_t>> pairs;
+};
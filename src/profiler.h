@@ -0,0 +1,92 @@
+#pragma once
+
+/**
+ * Cycle counts of the phases of the search, by remaining depth, measured with rdtsc.
+ * It is compiled only with SEARCH_PROFILER defined (the main_minmax_profile target),
+ * otherwise the PROFILE_ macros expand to nothing.
+ * A measure costs a few tens of cycles, so the counts of the cheapest phases are inflated.
+ */
+
+#ifdef SEARCH_PROFILER
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <cstdint>
+#include <x86intrin.h>
+
+#define PROFILE_DEPTH_BUCKETS (5) // remaining depth 0, 1, 2, 3 and 4 or more
+
+enum ProfilePhase {
+    MOVE_GENERATION,
+    ORDERING,
+    MAKE_UNMAKE,
+    TABLE_PROBE,
+    TABLE_STORE,
+    LEAF_SCORE,
+    TIME_CHECK,
+    NB_PROFILE_PHASES
+};
+
+class SearchProfiler {
+public:
+    SearchProfiler() {
+        reset();
+    }
+
+    void reset() {
+        for (auto& bucket : cycles) {
+            bucket.fill(0);
+        }
+        start = __rdtsc();
+    }
+
+    inline void add(int remainingDepth, ProfilePhase phase, uint64_t from) {
+        cycles[std::min(remainingDepth, PROFILE_DEPTH_BUCKETS - 1)][phase] += __rdtsc() - from;
+    }
+
+    /// the share of each phase and depth in the cycles since reset()
+    void print(std::ostream& os) const {
+        static const char* names[NB_PROFILE_PHASES] = {
+            "movegen", "ordering", "make/unmake", "tt probe", "tt store", "leaf score", "time check"
+        };
+        const double total = __rdtsc() - start;
+
+        os << std::fixed << std::setprecision(1) << std::setw(12) << "phase %";
+        for (int bucket = 0; bucket < PROFILE_DEPTH_BUCKETS; bucket++) {
+            os << std::setw(7) << ('d' + std::to_string(bucket) + (bucket == PROFILE_DEPTH_BUCKETS - 1 ? "+" : ""));
+        }
+        os << std::setw(8) << "all" << std::endl;
+
+        uint64_t measured = 0;
+        for (int phase = 0; phase < NB_PROFILE_PHASES; phase++) {
+            uint64_t sum = 0;
+            os << std::setw(12) << names[phase];
+            for (int bucket = 0; bucket < PROFILE_DEPTH_BUCKETS; bucket++) {
+                os << std::setw(7) << 100 * cycles[bucket][phase] / total;
+                sum += cycles[bucket][phase];
+            }
+            os << std::setw(8) << 100 * sum / total << std::endl;
+            measured += sum;
+        }
+        os << std::setw(12) << "other" << std::setw(7*PROFILE_DEPTH_BUCKETS + 8) << 100 * (total - measured) / total << std::endl
+            << "total: " << std::setprecision(3) << total / 1e6 << " Mcycles" << std::endl;
+    }
+
+private:
+    std::array<std::array<uint64_t, NB_PROFILE_PHASES>, PROFILE_DEPTH_BUCKETS> cycles;
+    uint64_t start;
+};
+
+#define PROFILE_START(name) const uint64_t name = __rdtsc()
+#define PROFILE_STOP(name, remainingDepth, phase) profiler.add(remainingDepth, phase, name)
+
+#else
+
+#define PROFILE_START(name)
+#define PROFILE_STOP(name, remainingDepth, phase)
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+#include "common/board.h"
+#include "common/move.h"
+
+#define BUDGET_TIME (450) // ms
+#define FAILSAFE_TIME (100) // ms
+#define SAFE_TIME (2*(BUDGET_TIME)) // ms
+
+/// time given to a move, from the time left in the time bank
+inline double computeTimeBudget(double availableTimeInMs) {
+    return (availableTimeInMs > SAFE_TIME) ? BUDGET_TIME : FAILSAFE_TIME;
+}
+
+/// "place_move x y" with the column and the row of the cell, or "no_moves"
+inline std::string formatMove(const Move& move) {
+    if (move == Move::end || move == Move::skip) {
+        return "no_moves";
+    }
+    return "place_move " + std::to_string(move.X()*3 + move.x()) + ' ' + std::to_string(move.Y()*3 + move.y());
+}
+
+/**
+ * A game of the riddles.io protocol, updated by the lines of the game engine:
+ * - settings your_botid P: the player of the bot
+ * - update game field F: the 81 cells of the board
+ * - update game macroboard M: the sub-boards to play in are -1, a single one gives the move generator
+ * - action move T: the bot must play, with T ms left in its time bank
+ * - end: the game is over
+ * Other lines are ignored.
+ */
+class RiddlesGame {
+public:
+    enum Command {
+        NONE,
+        ACTION,
+        END
+    };
+
+    /// ACTION with availableTimeInMs set when a move is asked
+    Command update(const std::string& line, int& availableTimeInMs) {
+        std::stringstream ss;
+        ss << line;
+
+        std::string op;
+        ss >> op;
+        if (op[0] == 's') {
+            std::string your_botid;
+            ss >> your_botid;
+            if (your_botid == "your_botid") {
+                char c;
+                ss >> c;
+                myPlayer = from_char(c);
+            }
+        }
+        else if (op[0] == 'u') {
+            std::string game;
+            ss >> game;
+
+            std::string op;
+            ss >> op;
+
+            if (game == "game" && op[0] == 'f') {
+                std::string new_board;
+                ss >> new_board;
+
+                board = Board(new_board);
+            }
+            else if (game == "game" && op[0] == 'm') {
+                moveGenerator = Move::any;
+
+                for (int Y = 0; Y < 3; Y++)
+                for (int X = 0; X < 3; X++) {
+                    std::string num;
+                    std::getline(ss, num, ',');
+
+                    if (num.find("-1") != std::string::npos) {
+                        if (moveGenerator == Move::any) {
+                            moveGenerator = Move(0, 0, Y, X);
+                        }
+                        else {
+                            moveGenerator = Move::any;
+                            return NONE;
+                        }
+                    }
+                }
+            }
+        }
+        else if (op[0] == 'a') {
+            std::string move;
+            ss >> move;
+            ss >> availableTimeInMs;
+            return ACTION;
+        }
+        else if (op[0] == 'e') {
+            return END;
+        }
+        return NONE;
+    }
+
+    Board board;
+    player_t myPlayer = Owner::Player0;
+    Move moveGenerator;
+};
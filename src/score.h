@@ -2,6 +2,9 @@
 
 #include <array>
 #include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
 
 #include <cmath>
 #include <climits>
@@ -13,13 +16,72 @@
 #include "common/board.h"
 
 #define VICTORY_POINTS (15)
+#define NB_SCORING_PARAMETERS (11)
+#define MAX_SCORING_PARAMETER (15) // 8 lines of 3 sub-boards of 15 points fit in a score_t
+
+/// scores of a sub-board for a player, the defaults are the hand-crafted ones
+struct ScoringParameters {
+	enum Index {
+		Victory,
+		WaysToWin5, WaysToWin4, WaysToWin3, WaysToWin2, WaysToWin1, // number of possible ways to win
+		Threats4, Threats3, Threats2, Threats1, Threats0 // number of threats (line started that could be completed)
+	};
+
+	std::array<score_t, NB_SCORING_PARAMETERS> values = {{
+		VICTORY_POINTS,
+		VICTORY_POINTS - 1, VICTORY_POINTS - 2, VICTORY_POINTS - 3, VICTORY_POINTS - 4, VICTORY_POINTS - 5,
+		6, 5, 4, 2, 1
+	}};
+
+	static const char* name(int i) {
+		static const char* names[NB_SCORING_PARAMETERS] = {
+			"victory",
+			"ways_to_win_5", "ways_to_win_4", "ways_to_win_3", "ways_to_win_2", "ways_to_win_1",
+			"threats_4", "threats_3", "threats_2", "threats_1", "threats_0"
+		};
+		return names[i];
+	}
+
+	/// a "name value" line per parameter, false on a missing, unknown or out of range one
+	bool load(const std::string& path) {
+		std::ifstream in(path);
+		std::array<bool, NB_SCORING_PARAMETERS> found = {};
+		std::string key;
+		int value;
+		while (in >> key >> value) {
+			int i = 0;
+			while (i < NB_SCORING_PARAMETERS && key != name(i)) {
+				i++;
+			}
+			if (i == NB_SCORING_PARAMETERS || value < 0 || value > MAX_SCORING_PARAMETER) {
+				return false;
+			}
+			values[i] = value;
+			found[i] = true;
+		}
+		return std::all_of(found.begin(), found.end(), [](bool f) { return f; });
+	}
+
+	bool save(const std::string& path) const {
+		std::ofstream out(path);
+		for (int i = 0; i < NB_SCORING_PARAMETERS; i++) {
+			out << name(i) << ' ' << values[i] << std::endl;
+		}
+		return (bool) out;
+	}
+};
 
 class Scoring {
 public:
-	Scoring() {
-		for (ttt_t ttt = 0; ttt < NUMBER_OF_TTT; ttt++) {
-			_score[2*ttt+Owner::Player0-1] = _compute_score(ttt, Owner::Player0);
-			_score[2*ttt+Owner::Player1-1] = _compute_score(ttt, Owner::Player1);
+	Scoring(const ScoringParameters& parameters = ScoringParameters()) {
+		setParameters(parameters);
+	}
+
+	/// rebuilds the sub-board scores from the parameter of each sub-board class (computed once)
+	void setParameters(const ScoringParameters& parameters) {
+		const auto& classes = _classes();
+		for (size_t i = 0; i < _score.size(); i++) {
+			_score[i] = (classes[i] < 0) ? 0 : parameters.values[classes[i]];
 		}
 	}
 
@@ -37,35 +99,58 @@ public:
 		else if (board.winner() == Owner::Draw) return DRAW_SCORE;
 	}
 
+	/// score of a game that is not over, from its sub-boards
+	inline score_t score(const std::array<ttt_t, 9>& board) const {
+		return _board_score(board);
+	}
+
+	/// the hand-crafted scores need no incremental state
+	inline void attach(Board&, Accumulator&) const {
+	}
+
 private:
-	score_t _compute_score(ttt_t ttt, Owner player) const {
+	/// the ScoringParameters::Index of each sub-board and player, -1 for a score of 0
+	static const std::vector<int8_t>& _classes() {
+		static const std::vector<int8_t> classes = []() {
+			std::vector<int8_t> all(2*NUMBER_OF_TTT);
+			for (ttt_t ttt = 0; ttt < NUMBER_OF_TTT; ttt++) {
+				all[2*ttt+Owner::Player0-1] = _compute_class(ttt, Owner::Player0);
+				all[2*ttt+Owner::Player1-1] = _compute_class(ttt, Owner::Player1);
+			}
+			return all;
+		}();
+		return classes;
+	}
+
+	static int8_t _compute_class(ttt_t ttt, Owner player) {
 		// victory
-		if (win(ttt, player)) return VICTORY_POINTS;
-		if (win(ttt, OTHER(player))) return 0;
+		if (win(ttt, player)) return ScoringParameters::Victory;
+		if (win(ttt, OTHER(player))) return -1;
 	
 		// draw (not winnable)
-		if (!winnable(ttt, player)) return 0;
+		if (!winnable(ttt, player)) return -1;
 	
 		// score based on number of possible ways to win
 		switch (number_of_ways_to_win(ttt, player)) {
-		case 5: return VICTORY_POINTS - 1;
-		case 4: return VICTORY_POINTS - 2;
-		case 3: return VICTORY_POINTS - 3;
-		case 2: return VICTORY_POINTS - 4;
-		case 1: return VICTORY_POINTS - 5;
+		case 5: return ScoringParameters::WaysToWin5;
+		case 4: return ScoringParameters::WaysToWin4;
+		case 3: return ScoringParameters::WaysToWin3;
+		case 2: return ScoringParameters::WaysToWin2;
+		case 1: return ScoringParameters::WaysToWin1;
 		case 0: break;
 		default: assert(0);
 		}
 	
 		// score based on number of threats (line started that could be completed)
 		switch (number_of_unique_threats(ttt, player)) {
-		case 4: return 6;
-		case 3: return 5;
-		case 2: return 4;
-		case 1: return 2;
-		case 0: return 1;
+		case 4: return ScoringParameters::Threats4;
+		case 3: return ScoringParameters::Threats3;
+		case 2: return ScoringParameters::Threats2;
+		case 1: return ScoringParameters::Threats1;
+		case 0: return ScoringParameters::Threats0;
 		default: assert(0);
 		}
+		return -1;
 	}
 
 	score_t _board_score(const std::array<ttt_t, 9>& board) const {
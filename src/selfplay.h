@@ -0,0 +1,288 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "minmax.h"
+#include "common/board.h"
+
+#define SELFPLAY_MAGIC "UTTTGAME"
+#define SELFPLAY_VERSION (1)
+#define SELFPLAY_TABLE_SIZE (1 << 22) // transposition table of each worker
+#define SELFPLAY_RANDOM_PLIES (8) // random moves at the start of each game
+#define SELFPLAY_BUFFER_SIZE (1 << 20) // bytes written or read at once
+#define SELFPLAY_MAX_RECORD_SIZE (3 + 9*9 + 2*9*9)
+
+/**
+ * Game records file: the magic SELFPLAY_MAGIC and the uint32 SELFPLAY_VERSION, then for each game
+ * - uint8 number of moves, uint8 number of random moves at the start, uint8 winner (Owner value, Draw for a draw)
+ * - one byte per move, its Move::j (from the empty board, Player0 first)
+ * - int16 (little endian) search score of each position before a move that is not random,
+ *   from the point of view of the player to move, DRAW_SCORE for a draw
+ */
+struct GameRecord {
+    int nbMoves;
+    int nbRandom;
+    player_t winner;
+    const uint8_t* moves;
+    const uint8_t* scores; /// nbMoves-nbRandom, unaligned
+
+    Move move(int i) const {
+        return Move(moves[i]);
+    }
+
+    /// score of the position before move i >= nbRandom
+    score_t score(int i) const {
+        const uint8_t* p = scores + 2*(i - nbRandom);
+        return (score_t) (p[0] | (p[1] << 8));
+    }
+
+    int size() const {
+        return 3 + nbMoves + 2*(nbMoves - nbRandom);
+    }
+};
+
+/// buffered game records writer, not thread safe
+class GameRecordWriter {
+public:
+    GameRecordWriter(std::ostream& out) : out(out) {
+        const uint32_t version = SELFPLAY_VERSION;
+        out.write(SELFPLAY_MAGIC, 8);
+        out.write((const char*) &version, sizeof(version));
+        buffer.reserve(SELFPLAY_BUFFER_SIZE + SELFPLAY_MAX_RECORD_SIZE);
+    }
+
+    ~GameRecordWriter() {
+        flush();
+    }
+
+    /// scores of the moves after the random ones
+    void write(const std::vector<Move>& moves, int nbRandom, player_t winner, const std::vector<score_t>& scores) {
+        buffer.push_back((uint8_t) moves.size());
+        buffer.push_back((uint8_t) nbRandom);
+        buffer.push_back((uint8_t) winner);
+        for (const Move& move : moves) {
+            buffer.push_back(move.j);
+        }
+        for (score_t score : scores) {
+            buffer.push_back((uint8_t) (score & 0xFF));
+            buffer.push_back((uint8_t) ((uint16_t) score >> 8));
+        }
+
+        if (buffer.size() >= SELFPLAY_BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    void flush() {
+        out.write((const char*) buffer.data(), buffer.size());
+        out.flush();
+        buffer.clear();
+    }
+
+private:
+    std::ostream& out;
+    std::vector<uint8_t> buffer;
+};
+
+/// reads the records from large blocks of the stream, without copying them
+class GameRecordReader {
+public:
+    GameRecordReader(std::istream& in) : in(in), buffer(SELFPLAY_BUFFER_SIZE + SELFPLAY_MAX_RECORD_SIZE) {
+        char magic[8];
+        uint32_t version = 0;
+        in.read(magic, sizeof(magic));
+        in.read((char*) &version, sizeof(version));
+        valid = in && std::memcmp(magic, SELFPLAY_MAGIC, sizeof(magic)) == 0 && version == SELFPLAY_VERSION;
+    }
+
+    /// false for a stream that is not a game records file
+    bool isValid() const {
+        return valid;
+    }
+
+    /// false at the end of the stream, or on a truncated or corrupted record (isValid() is then false)
+    bool next(GameRecord& record) {
+        if (!valid) {
+            return false;
+        }
+        if (end - position < SELFPLAY_MAX_RECORD_SIZE) {
+            refill();
+        }
+        if (position == end) {
+            return false;
+        }
+
+        const uint8_t* p = buffer.data() + position;
+        const size_t available = end - position;
+        record.nbMoves = p[0];
+        record.nbRandom = p[1];
+        record.winner = p[2];
+        if (available < 3 || record.nbMoves > 9*9 || record.nbRandom > record.nbMoves || record.winner > Owner::Draw
+            || available < (size_t) record.size()) {
+            valid = false;
+            return false;
+        }
+
+        record.moves = p + 3;
+        record.scores = record.moves + record.nbMoves;
+        position += record.size();
+        return true;
+    }
+
+private:
+    /// moves the unread bytes to the start of the buffer and reads after them
+    void refill() {
+        const size_t remaining = end - position;
+        std::memmove(buffer.data(), buffer.data() + position, remaining);
+        in.read((char*) buffer.data() + remaining, SELFPLAY_BUFFER_SIZE);
+        position = 0;
+        end = remaining + in.gcount();
+    }
+
+private:
+    std::istream& in;
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+    size_t end = 0;
+    bool valid;
+};
+
+/**
+ * Replays a record, calling f(field, player, score) for each position searched in the game,
+ * where field is the 81 cells (Y*3+y)*9 + X*3+x of the riddles protocol.
+ * The completed sub-boards are the normalized ones of Board (all the cells of the winner, or the
+ * draw pattern), so the cells are the inputs of the network evaluator (see Accumulator).
+ */
+template<class F>
+void forEachPosition(const GameRecord& record, F f) {
+    std::array<char, 9*9> field;
+    field.fill('.');
+
+    Board board;
+    player_t player = Owner::Player0;
+    for (int i = 0; i < record.nbMoves; i++) {
+        if (i >= record.nbRandom) {
+            f(field, player, record.score(i));
+        }
+
+        // a move can complete its sub-board, all of its cells are copied
+        const Move move = record.move(i);
+        board.action(move, player);
+        for (int j = 0; j < 9; j++) {
+            field[(move.Y()*3 + j/3)*9 + move.X()*3 + j%3] = to_char(board.get(move.YX(), j));
+        }
+        player = OTHER(player);
+    }
+}
+
+struct SelfplaySettings {
+    long nbGames = 1000;
+    int nbWorkers = std::thread::hardware_concurrency();
+    int depth = 6; /// of each search
+    long positions = 0; /// per search, 0 for no limit
+    int randomPlies = SELFPLAY_RANDOM_PLIES;
+    uint64_t seed = 0;
+};
+
+/**
+ * Plays games of MinMaxBasedAI against itself on a pool of worker threads, each one with its own search.
+ * The games start with random moves (from a generator seeded by the seed and the game index)
+ * and are written in the order they end.
+ */
+class Selfplay {
+    using SelfplayAI = MinMaxBasedAI<SELFPLAY_TABLE_SIZE>;
+
+public:
+    Selfplay(const Scoring& scoring, const SelfplaySettings& settings) : scoring(scoring), settings(settings) {
+    }
+
+    /// number of positions written
+    long run(GameRecordWriter& writer) {
+        nextGame.store(0);
+        nbPositions = 0;
+
+        const int nbWorkers = std::max(1, settings.nbWorkers);
+
+        std::vector<std::unique_ptr<SelfplayAI>> ais;
+        for (int i = 0; i < nbWorkers; i++) {
+            ais.emplace_back(new SelfplayAI(scoring));
+            ais.back()->setVerbose(false);
+            ais.back()->setPositionsLimit(settings.positions);
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < nbWorkers; i++) {
+            workers.emplace_back(&Selfplay::work, this, std::ref(*ais[i]), std::ref(writer));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        writer.flush();
+
+        return nbPositions;
+    }
+
+private:
+    void work(SelfplayAI& ai, GameRecordWriter& writer) {
+        std::vector<Move> moves;
+        std::vector<score_t> scores;
+
+        for (long game = nextGame++; game < settings.nbGames; game = nextGame++) {
+            std::mt19937_64 rng(settings.seed + game);
+            std::array<MoveValued, 9*9+1> possible;
+            moves.clear();
+            scores.clear();
+
+            Board board;
+            Move moveGenerator = Move::any;
+            player_t player = Owner::Player0;
+            while (board.winner() == Owner::None) {
+                Move move;
+                if ((int) moves.size() < settings.randomPlies) {
+                    board.possibleMoves(possible, moveGenerator);
+                    int nbMoves = 0;
+                    while (possible[nbMoves].move != Move::end) {
+                        nbMoves++;
+                    }
+                    move = possible[std::uniform_int_distribution<int>(0, nbMoves - 1)(rng)].move;
+                }
+                else {
+                    SearchResult result = ai.analyse(board, player, moveGenerator, std::numeric_limits<double>::infinity(), settings.depth);
+                    // the positions limit can abort the first depth
+                    if (result.best.move == Move::end) {
+                        ai.setPositionsLimit(0);
+                        result.best = ai.search(board, player, moveGenerator, MIN_DEPTH);
+                        ai.setPositionsLimit(settings.positions);
+                    }
+                    move = result.best.move;
+                    scores.push_back(result.best.value);
+                }
+
+                board.action(move, player);
+                moves.push_back(move);
+                moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+                player = OTHER(player);
+            }
+
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writer.write(moves, std::min((int) moves.size(), settings.randomPlies), board.winner(), scores);
+            nbPositions += scores.size();
+        }
+    }
+
+private:
+    const Scoring& scoring;
+    const SelfplaySettings settings;
+
+    std::atomic<long> nextGame;
+    std::mutex writerMutex;
+    long nbPositions;
+};
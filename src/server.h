@@ -0,0 +1,174 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "minmax.h"
+#include "riddles.h"
+#include "common/board.h"
+
+#define SERVER_MIN_TABLE_SIZE (1 << 12) // entries of the table of a game, whatever the memory budget
+#define SERVER_MIN_SEARCH_TIME (10) // ms given to a search that starts after the deadline of its game
+
+/// the largest power of two of entries such that the tables of nbGames games fit in memoryBytes
+inline long serverTableSize(long memoryBytes, int nbGames) {
+    const long entries = memoryBytes / std::max(1, nbGames) / (long) sizeof(ExploredPosition);
+    long size = SERVER_MIN_TABLE_SIZE;
+    while (2*size <= entries) {
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ * Hosts many games of the riddles.io protocol in one process, each line starts with the id of its game:
+ * "ID settings your_botid 0", "ID update game field ...", "ID action move 10000", "ID end"...
+ * and each answer too: "ID place_move x y", or "ID error too many games" beyond the maximum number of games.
+ *
+ * The games share the Scoring tables, each one has its own transposition table, of the size of its share
+ * of the memory budget. The searches run on a fixed pool of threads, the one of the earliest deadline first:
+ * a move asked with T ms left in the time bank is due computeTimeBudget(T) ms later, waiting included.
+ */
+class GameServer {
+    using ServerAI = MinMaxBasedAI<SERVER_MIN_TABLE_SIZE>;
+
+    struct Game {
+        RiddlesGame riddles;
+        std::unique_ptr<ServerAI> ai;
+        std::mutex searching; // the table of the game is used by one search at a time
+    };
+
+    struct Search {
+        std::string id;
+        std::shared_ptr<Game> game; // kept until the search ends, even if the game ended meanwhile
+        Board board; // copied, the game may be updated meanwhile
+        player_t player;
+        Move moveGenerator;
+        std::chrono::steady_clock::time_point deadline;
+
+        /// the earliest deadline is at the top of the priority queue
+        bool operator<(const Search& that) const {
+            return deadline > that.deadline;
+        }
+    };
+
+public:
+    GameServer(const Scoring& scoring, int nbThreads, long memoryBytes, int maxGames)
+        : scoring(scoring), nbThreads(std::max(1, nbThreads)), maxGames(std::max(1, maxGames)),
+          tableSize(serverTableSize(memoryBytes, maxGames)) {
+    }
+
+    /// until the end of the input, then the remaining searches are answered
+    void run(std::istream& in, std::ostream& out) {
+        finished = false;
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < nbThreads; i++) {
+            workers.emplace_back(&GameServer::work, this, std::ref(out));
+        }
+
+        std::map<std::string, std::shared_ptr<Game>> games;
+        std::string line;
+        while (std::getline(in, line)) {
+            const size_t separator = line.find(' ');
+            if (separator == std::string::npos) {
+                continue;
+            }
+            const std::string id = line.substr(0, separator);
+
+            auto found = games.find(id);
+            if (found == games.end()) {
+                if ((int) games.size() >= maxGames) {
+                    write(out, id + " error too many games");
+                    continue;
+                }
+                std::shared_ptr<Game> game(new Game());
+                game->ai.reset(new ServerAI(scoring, tableSize));
+                game->ai->setVerbose(false);
+                found = games.emplace(id, game).first;
+            }
+            const std::shared_ptr<Game>& game = found->second;
+
+            int availableTimeInMs;
+            const RiddlesGame::Command command = game->riddles.update(line.substr(separator + 1), availableTimeInMs);
+            if (command == RiddlesGame::ACTION) {
+                const auto deadline = std::chrono::steady_clock::now()
+                    + std::chrono::milliseconds((long) computeTimeBudget(availableTimeInMs));
+
+                std::lock_guard<std::mutex> lock(queueMutex);
+                searches.push({id, game, game->riddles.board, game->riddles.myPlayer, game->riddles.moveGenerator, deadline});
+                notEmpty.notify_one();
+            }
+            else if (command == RiddlesGame::END) {
+                games.erase(found);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            finished = true;
+        }
+        notEmpty.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /// entries of the transposition table of each game
+    long getTableSize() const {
+        return tableSize;
+    }
+
+private:
+    void work(std::ostream& out) {
+        Search search;
+        while (next(search)) {
+            std::lock_guard<std::mutex> lock(search.game->searching);
+
+            const double left = std::chrono::duration<double, std::milli>(search.deadline - std::chrono::steady_clock::now()).count();
+            const SearchResult result = search.game->ai->analyse(search.board, search.player, search.moveGenerator,
+                std::max(left, (double) SERVER_MIN_SEARCH_TIME));
+
+            write(out, search.id + ' ' + formatMove(result.best.move));
+        }
+    }
+
+    bool next(Search& search) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [&]() { return !searches.empty() || finished; });
+        if (searches.empty()) {
+            return false;
+        }
+
+        search = searches.top();
+        searches.pop();
+        return true;
+    }
+
+    void write(std::ostream& out, const std::string& line) {
+        std::lock_guard<std::mutex> lock(outMutex);
+        out << line << std::endl;
+    }
+
+private:
+    const Scoring& scoring;
+    const int nbThreads;
+    const int maxGames;
+    const long tableSize;
+
+    std::mutex queueMutex;
+    std::condition_variable notEmpty;
+    std::priority_queue<Search> searches;
+    bool finished;
+
+    std::mutex outMutex;
+};
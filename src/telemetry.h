@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+/// one JSON object, built field by field
+class JsonLine {
+public:
+    JsonLine& add(const char* key, long value) {
+        separate(key);
+        ss << value;
+        return *this;
+    }
+
+    JsonLine& add(const char* key, int value) {
+        return add(key, (long) value);
+    }
+
+    /// null when not finite (an infinite time budget)
+    JsonLine& add(const char* key, double value) {
+        separate(key);
+        if (std::isfinite(value))
+            ss << value;
+        else
+            ss << "null";
+        return *this;
+    }
+
+    /// value must not need escaping
+    JsonLine& add(const char* key, const char* value) {
+        separate(key);
+        ss << '"' << value << '"';
+        return *this;
+    }
+
+    std::string str() const {
+        return ss.str() + '}';
+    }
+
+private:
+    void separate(const char* key) {
+        ss << (empty ? '{' : ',') << '"' << key << "\":";
+        empty = false;
+    }
+
+private:
+    std::stringstream ss;
+    bool empty = true;
+};
+
+/**
+ * Destination of the search telemetry, one JSON object per line: "none", "stderr" or a file (appended).
+ * It can be shared by several searches, each line is written at once.
+ */
+class TelemetrySink {
+public:
+    /// false when the file can't be opened
+    bool open(const std::string& target) {
+        if (target == "none") {
+            out = nullptr;
+        }
+        else if (target == "stderr") {
+            out = &std::cerr;
+        }
+        else {
+            file.reset(new std::ofstream(target, std::ios::app));
+            if (!*file) {
+                return false;
+            }
+            out = file.get();
+        }
+        return true;
+    }
+
+    bool enabled() const {
+        return out != nullptr;
+    }
+
+    void write(const JsonLine& line) {
+        const std::string s = line.str();
+        std::lock_guard<std::mutex> lock(mutex);
+        *out << s << '\n';
+        out->flush();
+    }
+
+private:
+    std::ostream* out = nullptr;
+    std::unique_ptr<std::ofstream> file;
+    std::mutex mutex;
+};
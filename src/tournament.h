@@ -0,0 +1,347 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "minmax.h"
+#include "mcts.h"
+#include "random_bot.h"
+#include "common/board.h"
+
+#define TOURNAMENT_TABLE_SIZE (1 << 22) // transposition table of each minmax player
+#define TOURNAMENT_OPENING_PLIES (4) // random moves played before the engines
+#define TOURNAMENT_TIME_MARGIN (20) // ms over the time per move before a loss on time
+
+/// limits of each move, the search stops at the first one reached
+struct TournamentLimits {
+    double time = std::numeric_limits<double>::infinity(); /// ms
+    long nodes = 0; /// minmax positions or MCTS playouts, 0 for no limit
+    int depth = MAX_DEPTH; /// minmax only
+};
+
+/// an engine playing in process, one instance per game at a time
+class TournamentPlayer {
+public:
+    virtual ~TournamentPlayer() {
+    }
+
+    virtual Move play(Board& board, player_t player, const Move& moveGenerator, const TournamentLimits& limits) = 0;
+};
+
+template<class Evaluator = Scoring>
+class MinMaxPlayer : public TournamentPlayer {
+public:
+    MinMaxPlayer(const Evaluator& scoring, const ProbCutParameters& probCut = ProbCutParameters())
+        : ai(new MinMaxBasedAI<TOURNAMENT_TABLE_SIZE, Evaluator>(scoring)) {
+        ai->setVerbose(false);
+        ai->setProbCut(probCut);
+    }
+
+    Move play(Board& board, player_t player, const Move& moveGenerator, const TournamentLimits& limits) override {
+        ai->setPositionsLimit(limits.nodes);
+        return ai->analyse(board, player, moveGenerator, limits.time, limits.depth).best.move;
+    }
+
+private:
+    std::unique_ptr<MinMaxBasedAI<TOURNAMENT_TABLE_SIZE, Evaluator>> ai;
+};
+
+class MCTSPlayer : public TournamentPlayer {
+public:
+    /// a scoring enables the MCTS-minimax hybrid
+    MCTSPlayer(const Scoring* hybridScoring = nullptr) : ai(1) {
+        ai.setVerbose(false);
+        if (hybridScoring != nullptr) {
+            ai.enableHybrid(*hybridScoring);
+        }
+    }
+
+    Move play(Board& board, player_t player, const Move& moveGenerator, const TournamentLimits& limits) override {
+        ai.setPlayoutsLimit(limits.nodes);
+        return ai.play(board, player, moveGenerator, limits.time);
+    }
+
+private:
+    MCTSBasedAI ai;
+};
+
+class RandomPlayer : public TournamentPlayer {
+public:
+    Move play(Board& board, player_t, const Move& moveGenerator, const TournamentLimits& limits) override {
+        return ai.play(board, true, moveGenerator, limits.time);
+    }
+
+private:
+    RandomAI ai;
+};
+
+/**
+ * Results of the first engine against the second one, with its Elo difference
+ * and the log-likelihood ratio of the SPRT of H1: elo >= elo1 against H0: elo <= elo0.
+ */
+struct TournamentScore {
+    long wins = 0;
+    long draws = 0;
+    long losses = 0;
+    long timeLosses = 0; /// of both engines, counted in wins and losses
+
+    long games() const {
+        return wins + draws + losses;
+    }
+
+    double score() const {
+        return games() == 0 ? 0.5 : (wins + 0.5*draws) / games();
+    }
+
+    double elo() const {
+        return scoreToElo(score());
+    }
+
+    /// half width of the 95% confidence interval
+    double eloMargin() const {
+        if (games() == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        const double margin = 1.96 * std::sqrt(variance() / games());
+        return (scoreToElo(score() + margin) - scoreToElo(score() - margin)) / 2;
+    }
+
+    /// generalized SPRT with the normal approximation of the trinomial game results
+    double llr(double elo0, double elo1) const {
+        const double var = variance();
+        if (games() == 0 || var <= 0) {
+            return 0;
+        }
+        const double s0 = eloToScore(elo0);
+        const double s1 = eloToScore(elo1);
+        return games() * (s1 - s0) * (2*score() - s0 - s1) / (2*var);
+    }
+
+    static double eloToScore(double elo) {
+        return 1 / (1 + std::pow(10., -elo / 400));
+    }
+
+    static double scoreToElo(double score) {
+        // a score of 0 or 1 has no finite Elo
+        const double clamped = std::min(std::max(score, 1e-6), 1 - 1e-6);
+        return -400 * std::log10(1/clamped - 1);
+    }
+
+private:
+    /// variance of the result of one game
+    double variance() const {
+        const double s = score();
+        return (wins*(1-s)*(1-s) + draws*(0.5-s)*(0.5-s) + losses*s*s) / games();
+    }
+};
+
+struct TournamentSettings {
+    TournamentLimits limits;
+    long maxGames = 1000; /// played by pairs, both engines play each opening with each colour
+    int nbWorkers = std::thread::hardware_concurrency();
+    int openingPlies = TOURNAMENT_OPENING_PLIES;
+    uint64_t seed = 0;
+
+    bool sprt = false;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+/**
+ * Plays games between two in-process engines on a pool of worker threads.
+ * Each worker has its own instance of both engines; games are played in pairs from the same
+ * random opening with swapped colours, and the run ends after maxGames or when the SPRT concludes.
+ */
+class Tournament {
+public:
+    using Factory = std::function<std::unique_ptr<TournamentPlayer>()>;
+
+    Tournament(const Factory& first, const Factory& second, const TournamentSettings& settings)
+        : first(first), second(second), settings(settings) {
+    }
+
+    /// a progress line is written after each game
+    TournamentScore run(std::ostream& out) {
+        result = TournamentScore();
+        nextPair.store(0);
+        finished.store(false);
+
+        const int nbWorkers = std::max(1, settings.nbWorkers);
+
+        std::vector<std::unique_ptr<TournamentPlayer>> players;
+        for (int i = 0; i < nbWorkers; i++) {
+            players.push_back(first());
+            players.push_back(second());
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < nbWorkers; i++) {
+            workers.emplace_back(&Tournament::work, this, players[2*i].get(), players[2*i+1].get(), std::ref(out));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        return result;
+    }
+
+    /// 1 when H1 is accepted, -1 when H0 is accepted, 0 while undecided
+    int sprtDecision(const TournamentScore& score) const {
+        const double llr = score.llr(settings.elo0, settings.elo1);
+        if (llr >= upperBound()) {
+            return 1;
+        }
+        if (llr <= lowerBound()) {
+            return -1;
+        }
+        return 0;
+    }
+
+    double lowerBound() const {
+        return std::log(settings.beta / (1 - settings.alpha));
+    }
+
+    double upperBound() const {
+        return std::log((1 - settings.beta) / settings.alpha);
+    }
+
+private:
+    void work(TournamentPlayer* firstPlayer, TournamentPlayer* secondPlayer, std::ostream& out) {
+        const long nbPairs = (settings.maxGames + 1) / 2;
+
+        for (long pair = nextPair++; pair < nbPairs && !finished.load(); pair = nextPair++) {
+            const std::vector<Move> opening = randomOpening(settings.seed + pair);
+
+            for (int game = 0; game < 2 && 2*pair + game < settings.maxGames; game++) {
+                // the first engine plays Player0 in the first game of the pair
+                TournamentPlayer* players[2] = {firstPlayer, secondPlayer};
+                if (game == 1) {
+                    std::swap(players[0], players[1]);
+                }
+
+                bool lostOnTime = false;
+                const player_t winner = playGame(players, opening, lostOnTime);
+                const player_t firstColor = (game == 0) ? Owner::Player0 : Owner::Player1;
+
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (winner == firstColor)
+                    result.wins++;
+                else if (winner == OTHER(firstColor))
+                    result.losses++;
+                else
+                    result.draws++;
+                result.timeLosses += lostOnTime;
+
+                report(out);
+                if (settings.sprt && sprtDecision(result) != 0) {
+                    finished.store(true);
+                }
+            }
+        }
+    }
+
+    /// the winner (Owner::Draw for a draw), an illegal move or a move out of time loses
+    player_t playGame(TournamentPlayer* players[2], const std::vector<Move>& opening, bool& lostOnTime) const {
+        Board board;
+        Move moveGenerator = Move::any;
+        player_t player = Owner::Player0;
+
+        for (const Move& move : opening) {
+            board.action(move, player);
+            moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+            player = OTHER(player);
+        }
+
+        std::array<MoveValued, 9*9+1> moves;
+        while (board.winner() == Owner::None) {
+            TournamentPlayer* current = players[player == Owner::Player0 ? 0 : 1];
+
+            Board searched = board;
+            const auto start = std::chrono::steady_clock::now();
+            const Move move = current->play(searched, player, moveGenerator, settings.limits);
+            const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (elapsed > settings.limits.time + TOURNAMENT_TIME_MARGIN) {
+                lostOnTime = true;
+                return OTHER(player);
+            }
+            if (!isLegal(board, moveGenerator, move, moves)) {
+                return OTHER(player);
+            }
+
+            board.action(move, player);
+            moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+            player = OTHER(player);
+        }
+        return board.winner();
+    }
+
+    static bool isLegal(const Board& board, const Move& moveGenerator, const Move& move, std::array<MoveValued, 9*9+1>& moves) {
+        board.possibleMoves(moves, moveGenerator);
+        for (const MoveValued& mv : moves) {
+            if (mv.move == Move::end) break;
+            if (mv.move == move) return true;
+        }
+        return false;
+    }
+
+    /// legal random moves, from a generator of its own so the openings only depend on the seed
+    std::vector<Move> randomOpening(uint64_t seed) const {
+        std::mt19937_64 rng(seed);
+        std::array<MoveValued, 9*9+1> moves;
+        std::vector<Move> opening;
+
+        Board board;
+        Move moveGenerator = Move::any;
+        player_t player = Owner::Player0;
+        for (int ply = 0; ply < settings.openingPlies && board.winner() == Owner::None; ply++) {
+            board.possibleMoves(moves, moveGenerator);
+            int nbMoves = 0;
+            while (moves[nbMoves].move != Move::end) {
+                nbMoves++;
+            }
+
+            const Move move = moves[std::uniform_int_distribution<int>(0, nbMoves - 1)(rng)].move;
+            board.action(move, player);
+            opening.push_back(move);
+            moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+            player = OTHER(player);
+        }
+        return opening;
+    }
+
+    void report(std::ostream& out) const {
+        out << std::fixed << std::setprecision(1)
+            << "games " << result.games() << ": +" << result.wins << " =" << result.draws << " -" << result.losses
+            << ", score " << 100 * result.score() << "%"
+            << ", elo " << result.elo() << " +- " << result.eloMargin();
+        if (settings.sprt) {
+            out << std::setprecision(2)
+                << ", llr " << result.llr(settings.elo0, settings.elo1) << " (" << lowerBound() << ", " << upperBound() << ")";
+        }
+        out << std::endl;
+    }
+
+private:
+    const Factory first;
+    const Factory second;
+    const TournamentSettings settings;
+
+    std::atomic<long> nextPair;
+    std::atomic<bool> finished;
+
+    std::mutex resultMutex;
+    TournamentScore result;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <vector>
+#include <cassert>
 #include <cstring>
 #include <cstdint>
 #include <ostream>
@@ -32,18 +34,29 @@ struct TranspositionTableCounters {
   * Two different hash are used per position :
   * - the index of the entry in the table can be any one of the two hash.
   * - the hash stored is the other one (hence the name otherHash).
+  * The capacity (CAPACITY unless given at construction) is a power of two.
   */
 
 template<int CAPACITY>
 class TranspositionTable {
 public:
-	TranspositionTable<CAPACITY>() : positions(CAPACITY) {
-		counters.capacity = CAPACITY;
+	TranspositionTable<CAPACITY>(long capacity = CAPACITY) : positions(capacity), mask(capacity - 1) {
+		assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+		counters.capacity = capacity;
 
 		for (ExploredPosition& pos : positions)
 			pos.type = ExploredPositionType::UNKWN;
 	}
 
+	/// empties the table, the counters except the capacity restart from zero
+	void clear() {
+		for (ExploredPosition& pos : positions)
+			pos.type = ExploredPositionType::UNKWN;
+
+		counters = TranspositionTableCounters();
+		counters.capacity = positions.size();
+	}
+
 	const ExploredPosition* get(const std::array<ttt_t, 9>& board, player_t player, const Move& moveGenerator) const {
 		counters.get++;
 		
@@ -54,7 +67,7 @@ public:
 		const auto h1 = pos_hash<1>(board, encodePlayerAsBool(player), fullMoves, mov);
 
 		{
-      const auto* ptr0 = &positions[h0%CAPACITY];
+      const auto* ptr0 = &positions[h0 & mask];
 			const auto& p0 = *ptr0;
 			if (p0.otherHash == h1 && p0.player == encodePlayerAsBool(player)
 					&& p0.fullMoves == fullMoves
@@ -64,7 +77,7 @@ public:
 			}
 		}
 		{
-      const auto* ptr1 = &positions[h1%CAPACITY];
+      const auto* ptr1 = &positions[h1 & mask];
 			const auto& p1 = *ptr1;
 			if (p1.otherHash == h0 && p1.player == encodePlayerAsBool(player)
 					&& p1.fullMoves == fullMoves
@@ -86,8 +99,8 @@ public:
 		const auto h0 = pos_hash<0>(board, pos.player, pos.fullMoves, mov);
 		const auto h1 = pos_hash<1>(board, pos.player, pos.fullMoves, mov);
 
-		auto* ptr0 = &positions[h0%CAPACITY];
-		auto* ptr1 = &positions[h1%CAPACITY];
+		auto* ptr0 = &positions[h0 & mask];
+		auto* ptr1 = &positions[h1 & mask];
 
 		const bool equals0 = (ptr0->otherHash == h1 && ptr0->player == pos.player
 							  && ptr0->fullMoves == pos.fullMoves
@@ -152,6 +165,7 @@ private:
 
 private:
 	std::vector<ExploredPosition> positions;
+	const hash_t mask; // capacity - 1
 
 	std::array<Hashers, 2> hashers;
 
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "score.h"
+#include "selfplay.h"
+#include "common/board.h"
+
+#define TUNER_MIN_SCALE (1.)
+#define TUNER_MAX_SCALE (100000.)
+#define TUNER_SCALE_ITERATIONS (60)
+
+/// a searched position of a self-play game and the result of the game
+struct TunerPosition {
+    std::array<ttt_t, 9> board; /// normalized sub-boards, as scored in the search
+    float result; /// for Player0: 1 win, 0.5 draw, 0 loss
+};
+
+/**
+ * Texel tuning of the ScoringParameters: minimizes the mean squared error between the game results
+ * and sigmoid(score / scale) of the positions, by coordinate descent with integer steps.
+ * The sub-board scores are rebuilt from the classes computed once by Scoring, and the error
+ * of each candidate is summed over the positions split between the threads.
+ */
+class ScoringTuner {
+public:
+    ScoringTuner(const std::vector<TunerPosition>& positions, int nbThreads)
+        : positions(positions), nbThreads(std::max(1, nbThreads)), scoring(new Scoring()), partialErrors(this->nbThreads) {
+    }
+
+    /// the searched positions of the games of a self-play records file
+    static void load(GameRecordReader& reader, std::vector<TunerPosition>& positions) {
+        GameRecord record;
+        while (reader.next(record)) {
+            const float result = (record.winner == Owner::Player0) ? 1 : (record.winner == Owner::Player1) ? 0 : 0.5;
+
+            Board board;
+            player_t player = Owner::Player0;
+            for (int i = 0; i < record.nbMoves; i++) {
+                if (i >= record.nbRandom) {
+                    positions.push_back({board.getBoard(), result});
+                }
+                board.action(record.move(i), player);
+                player = OTHER(player);
+            }
+        }
+    }
+
+    /// mean squared error of the parameters with the current scale
+    double error(const ScoringParameters& parameters) {
+        scoring->setParameters(parameters);
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < nbThreads; t++) {
+            threads.emplace_back(&ScoringTuner::sumErrors, this, t);
+        }
+        sumErrors(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        double sum = 0;
+        for (double partial : partialErrors) {
+            sum += partial;
+        }
+        return positions.empty() ? 0 : sum / positions.size();
+    }
+
+    /// sets the scale minimizing the error of the parameters, by golden section search on its logarithm
+    double fitScale(const ScoringParameters& parameters) {
+        const double phi = (std::sqrt(5.) - 1) / 2;
+        double a = std::log(TUNER_MIN_SCALE);
+        double b = std::log(TUNER_MAX_SCALE);
+        for (int i = 0; i < TUNER_SCALE_ITERATIONS; i++) {
+            const double c = b - phi*(b - a);
+            const double d = a + phi*(b - a);
+            scale = std::exp(c);
+            const double errorC = error(parameters);
+            scale = std::exp(d);
+            const double errorD = error(parameters);
+            if (errorC < errorD)
+                b = d;
+            else
+                a = c;
+        }
+        scale = std::exp((a + b) / 2);
+        return scale;
+    }
+
+    /// coordinate descent from parameters, until a pass improves nothing or after maxPasses
+    ScoringParameters tune(ScoringParameters parameters, int maxPasses, std::ostream& log) {
+        double best = error(parameters);
+        log << "error: " << best << std::endl;
+
+        for (int pass = 0; pass < maxPasses; pass++) {
+            bool improved = false;
+            for (int i = 0; i < NB_SCORING_PARAMETERS; i++) {
+                for (int delta : {+1, -1}) {
+                    // keeps stepping in a direction while it improves
+                    while (true) {
+                        ScoringParameters candidate = parameters;
+                        candidate.values[i] += delta;
+                        if (candidate.values[i] < 0 || candidate.values[i] > MAX_SCORING_PARAMETER) {
+                            break;
+                        }
+                        const double e = error(candidate);
+                        if (e >= best) {
+                            break;
+                        }
+                        best = e;
+                        parameters = candidate;
+                        improved = true;
+                    }
+                }
+            }
+
+            log << "pass " << pass+1 << ", error: " << best << ", parameters:";
+            for (score_t value : parameters.values) {
+                log << ' ' << value;
+            }
+            log << std::endl;
+
+            if (!improved) {
+                break;
+            }
+        }
+        return parameters;
+    }
+
+    double getScale() const {
+        return scale;
+    }
+
+private:
+    void sumErrors(int thread) {
+        const size_t begin = positions.size() * thread / nbThreads;
+        const size_t end = positions.size() * (thread+1) / nbThreads;
+
+        double sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            const double predicted = 1 / (1 + std::exp(-scoring->score(positions[i].board) / scale));
+            const double diff = positions[i].result - predicted;
+            sum += diff*diff;
+        }
+        partialErrors[thread] = sum;
+    }
+
+private:
+    const std::vector<TunerPosition>& positions;
+    const int nbThreads;
+    std::unique_ptr<Scoring> scoring;
+    std::vector<double> partialErrors;
+    double scale = 400;
+};
@@ -3,6 +3,7 @@
 #include <array>
 #include <random>
 #include <algorithm>
+#include <mutex>
 
 #include <cstdint>
 
@@ -13,6 +14,14 @@ using hash_t = std::uint32_t;
 std::random_device dev;
 std::mt19937 rd(dev());
 std::uniform_int_distribution<hash_t> dist;
+std::mutex hashersMutex; // guards rd and dist, the hashers can be built on any thread
+
+/// the hashers built after this call draw reproducible hashes (instead of random ones)
+inline void seedHashers(std::mt19937::result_type seed) {
+	std::lock_guard<std::mutex> lock(hashersMutex);
+	rd.seed(seed);
+	dist.reset();
+}
 
 /** This is a class to generate automatically a high quality hash function.
   * The hash are randomly generated and stored.
@@ -23,6 +32,7 @@ template<typename T, int COUNT>
 class ZobristHasher {
 public:
 	ZobristHasher() {
+		std::lock_guard<std::mutex> lock(hashersMutex);
 		std::generate(_hash.begin(), _hash.end(), [&]() { return dist(rd); });
 	}
 
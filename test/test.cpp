@@ -2,6 +2,25 @@
 
 #include "common/ttt.h"
 #include "common/ttt_utils.h"
+#include "mcts.h"
+#include "playout.h"
+#include "nnue.h"
+#include "perft.h"
+#include "batch.h"
+#include "analysis.h"
+#include "server.h"
+#include "tournament.h"
+#include "selfplay.h"
+#include "tuner.h"
+#include "bench.h"
+#include "probcut.h"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
 
 TEST(ttt, tttBeginRangeIsValid)
 {
@@ -139,3 +158,938 @@ TEST(tttUtils, winnableEquivalenceTest)
     }
   }
 }
+
+// every macro line but the diagonal of Player0 holds both players, Player0 threatens to win the last sub-board,
+// the top middle one has a free cell but nobody can win it
+static const char* almostDeadField =
+    "000010111"
+    "...011..."
+    "...10...."
+    "111000000"
+    "........."
+    "........."
+    "00011111."
+    "......00."
+    "......0..";
+
+TEST(board, drawDeclaredWhenNoMacroLineIsLeft)
+{
+  Board board(almostDeadField);
+  EXPECT_EQ(board.winner(), Owner::None);
+
+  // Player1 takes the last sub-board, no macro line is left to anyone
+  board.action(Move(2, 2, 0, 2), Owner::Player1);
+  EXPECT_EQ(board.winner(), Owner::Draw);
+  EXPECT_FALSE(board.isOver());
+
+  std::string field(almostDeadField);
+  field[6*9 + 8] = '1';
+  EXPECT_EQ(Board(field).winner(), Owner::Draw);
+
+  board.cancel();
+  EXPECT_EQ(board.winner(), Owner::None);
+
+  board.action(Move(2, 2, 2, 2), Owner::Player1);
+  EXPECT_EQ(board.winner(), Owner::None);
+}
+
+TEST(playout, avx2KernelMatchesScalarReference)
+{
+  if (!PlayoutEngine::hasAVX2())
+    GTEST_SKIP();
+
+  PlayoutEngine simd(42);
+  PlayoutEngine scalar(42);
+
+  Board board;
+  Move moveGenerator = Move::any;
+  player_t player = Owner::Player0;
+
+  // same games from successive positions of one game
+  for (int ply = 0; board.winner() == Owner::None; ++ply)
+  {
+    simd.load(board, moveGenerator);
+    simd.runAVX2(player);
+    scalar.load(board, moveGenerator);
+    scalar.runScalar(player);
+
+    const auto& a = simd.getLanes();
+    const auto& b = scalar.getLanes();
+    EXPECT_EQ(a.cells, b.cells);
+    EXPECT_EQ(a.macro, b.macro);
+    EXPECT_EQ(a.closed, b.closed);
+    EXPECT_EQ(a.winner, b.winner);
+    EXPECT_EQ(a.rng, b.rng);
+
+    std::array<MoveValued, 9*9+1> moves;
+    board.possibleMoves(moves, moveGenerator);
+    int nbMoves = 0;
+    while (moves[nbMoves].move != Move::end)
+      nbMoves++;
+
+    const Move move = moves[(7 * ply) % nbMoves].move;
+    board.action(move, player);
+    moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+    player = OTHER(player);
+  }
+}
+
+TEST(playout, scalarReferenceMatchesBoard)
+{
+  PlayoutEngine engine(7);
+  std::array<std::array<Move, 9*9+1>, PLAYOUT_LANES> history;
+
+  for (int run = 0; run < 100; ++run)
+  {
+    const Board start;
+    engine.load(start, Move::any);
+    engine.runScalar(Owner::Player0, &history);
+
+    for (int lane = 0; lane < PLAYOUT_LANES; ++lane)
+    {
+      Board board;
+      Move moveGenerator = Move::any;
+      player_t player = Owner::Player0;
+
+      for (const Move& move : history[lane])
+      {
+        if (move == Move::end)
+          break;
+
+        ASSERT_FALSE(board.isOver()); // the playouts go on after an early draw
+        ASSERT_TRUE(board.isValidMove(moveGenerator, move));
+        board.action(move, player);
+        moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+        player = OTHER(player);
+      }
+
+      EXPECT_EQ(board.winner(), static_cast<player_t>(engine.getLanes().winner[lane]));
+    }
+  }
+}
+
+TEST(mcts, solverPlaysProvenWin)
+{
+  // Player0 has won the first two sub-boards of the top row and completes the third one
+  Board board(
+    "00000000."
+    "........."
+    "........."
+    "11.11.11."
+    "........."
+    "........."
+    "........."
+    "........."
+    "........."
+  );
+
+  MCTSBasedAI ai(1);
+  EXPECT_EQ(ai.play(board, Owner::Player0, Move(0, 0, 0, 2), 1000), Move(0, 2, 0, 2));
+}
+
+static void randomNetwork(NnueNetwork& network, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> small(-64, 64);
+  std::uniform_int_distribution<int> byte(-128, 127);
+
+  for (auto& b : network.features.bias) b = small(rng);
+  for (auto& w : network.features.weights) for (auto& v : w) v = small(rng);
+  for (auto& w : network.hiddenWeights) for (auto& v : w) v = byte(rng);
+  for (auto& b : network.hiddenBias) b = 64 * small(rng);
+  for (auto& w : network.outputWeights) w = small(rng);
+  network.outputBias = 64 * small(rng);
+}
+
+TEST(nnue, incrementalAccumulatorMatchesRefresh)
+{
+  NnueNetwork network;
+  randomNetwork(network, 1);
+
+  Board board;
+  Accumulator accumulator;
+  accumulator.use(network.features);
+  board.attach(&accumulator);
+
+  Accumulator fresh;
+  fresh.use(network.features);
+
+  Move moveGenerator = Move::any;
+  player_t player = Owner::Player0;
+  std::vector<Accumulator::Values> history;
+
+  // sub-boards get won and drawn along the game, which changes several features at once
+  for (int ply = 0; board.winner() == Owner::None; ++ply)
+  {
+    history.push_back(accumulator.current());
+
+    std::array<MoveValued, 9*9+1> moves;
+    board.possibleMoves(moves, moveGenerator);
+    int nbMoves = 0;
+    while (moves[nbMoves].move != Move::end)
+      nbMoves++;
+
+    const Move move = moves[(7 * ply) % nbMoves].move;
+    board.action(move, player);
+    moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+    player = OTHER(player);
+
+    fresh.refresh(board.getBoard());
+    EXPECT_EQ(accumulator.current(), fresh.current());
+  }
+
+  // cancels restore the previous values
+  while (!history.empty())
+  {
+    board.cancel();
+    EXPECT_EQ(accumulator.current(), history.back());
+    history.pop_back();
+  }
+}
+
+/// first layer values of the features train_nnue.py reads from a field of the riddles protocol
+static Accumulator::Values fieldFeatures(const FeatureWeights& features, const std::string& field)
+{
+  Accumulator::Values values = features.bias;
+  for (int Y = 0; Y < 3; Y++)
+  for (int y = 0; y < 3; y++)
+  for (int X = 0; X < 3; X++)
+  for (int x = 0; x < 3; x++)
+  {
+    const player_t c = from_char(field[(Y*3 + y)*9 + X*3 + x]);
+    if (c != Owner::None)
+    {
+      const auto& w = features.weights[NNUE_FEATURE(Y*3 + X, y*3 + x, c)];
+      for (int h = 0; h < NNUE_HIDDEN; h++) values[h] += w[h];
+    }
+  }
+  return values;
+}
+
+// a won (top left) and a drawn (top middle) sub-board, raw and as train_nnue.py normalizes them (see test_train_nnue.py)
+static const std::string RAW_FIELD =
+  "000010..."
+  "1.1011..."
+  "...101..."
+  "...1....."
+  "....0...."
+  "........."
+  "........."
+  "........."
+  "........."
+;
+static const std::string NORMALIZED_FIELD =
+  "000010..."
+  "000011..."
+  "000100..."
+  "...1....."
+  "....0...."
+  "........."
+  "........."
+  "........."
+  "........."
+;
+
+TEST(nnue, normalizedFieldIsTheBoardFeatures)
+{
+  NnueNetwork network;
+  randomNetwork(network, 3);
+  Accumulator accumulator;
+  accumulator.use(network.features);
+
+  const Board board(RAW_FIELD);
+  ASSERT_TRUE(board.isWonOrFull_d(0));
+  ASSERT_TRUE(board.isWonOrFull_d(1));
+  accumulator.refresh(board.getBoard());
+  EXPECT_EQ(fieldFeatures(network.features, NORMALIZED_FIELD), accumulator.current());
+  EXPECT_NE(fieldFeatures(network.features, RAW_FIELD), accumulator.current());
+}
+
+TEST(nnue, avx2ForwardMatchesScalar)
+{
+  if (!NnueNetwork::hasAVX2())
+    GTEST_SKIP();
+
+  NnueNetwork network;
+  randomNetwork(network, 2);
+
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> value(-200, 300);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    Accumulator::Values values;
+    for (auto& v : values) v = value(rng);
+
+    EXPECT_EQ(network.forwardAVX2(values), network.forwardScalar(values));
+  }
+}
+
+TEST(perft, emptyBoardLeafCounts)
+{
+  const std::array<uint64_t, 9> expected = {1, 81, 720, 6336, 55080, 473256, 4020960, 33782544, 281067408};
+
+  Perft perft;
+  std::array<uint64_t, 9*9> divide;
+  for (int depth = 0; depth < (int) expected.size(); ++depth)
+    EXPECT_EQ(perft.run(Board(), Move::any, Owner::Player0, depth, 2, divide), expected[depth]) << "depth " << depth;
+}
+
+TEST(perft, bulkCountingAndCacheKeepLeafCounts)
+{
+  // sub-boards won by each player and one drawn, Player1 has to play in the center sub-board
+  const Board board(
+    "0,0,0,1,.,.,.,.,.,"
+    ".,.,.,.,1,.,0,.,.,"
+    ".,.,.,.,.,1,.,.,.,"
+    "1,0,1,.,.,.,.,.,.,"
+    "1,0,0,.,0,.,.,.,.,"
+    "0,1,1,.,.,.,.,.,.,"
+    ".,.,.,.,.,.,.,.,.,"
+    ".,.,.,.,.,.,.,.,.,"
+    ".,.,.,.,.,.,.,.,.");
+  const Move moveGenerator(0, 0, 1, 1);
+
+  std::array<uint64_t, 9*9> divide;
+  const uint64_t reference = Perft(false, 0).run(board, moveGenerator, Owner::Player1, 5, 1, divide);
+  EXPECT_GT(reference, 0u);
+  EXPECT_EQ(Perft(true, 0).run(board, moveGenerator, Owner::Player1, 5, 1, divide), reference);
+  EXPECT_EQ(Perft(false, 1 << 10).run(board, moveGenerator, Owner::Player1, 5, 1, divide), reference);
+  EXPECT_EQ(Perft(true, 1 << 10).run(board, moveGenerator, Owner::Player1, 5, 3, divide), reference);
+}
+
+static const std::string EMPTY_FIELD =
+  ".,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,."
+  ",.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.,.";
+
+TEST(batch, parsesRecords)
+{
+  BatchRecord record;
+  ASSERT_TRUE(record.parse(EMPTY_FIELD + " 4 1 depth 6"));
+  EXPECT_EQ(record.forced, 4);
+  EXPECT_EQ(record.player, Owner::Player1);
+  EXPECT_EQ(record.depth, 6);
+
+  ASSERT_TRUE(record.parse(EMPTY_FIELD + " -1 0 time 250"));
+  EXPECT_EQ(record.forced, -1);
+  EXPECT_EQ(record.depth, MAX_DEPTH);
+  EXPECT_EQ(record.time, 250);
+
+  EXPECT_FALSE(record.parse(EMPTY_FIELD + " 9 0 depth 6"));
+  EXPECT_FALSE(record.parse(EMPTY_FIELD + " -1 2 depth 6"));
+  EXPECT_FALSE(record.parse(EMPTY_FIELD + " -1 0 nodes 6"));
+  EXPECT_FALSE(record.parse(".,.,. -1 0 depth 6"));
+}
+
+TEST(batch, analysesEveryRecord)
+{
+  std::stringstream in;
+  in << "# comment" << std::endl;
+  for (int forced = 0; forced < 9; ++forced)
+    in << EMPTY_FIELD << ' ' << forced << " 0 depth 4" << std::endl;
+  in << "not a record" << std::endl;
+
+  const Scoring scoring;
+  BatchAnalyser analyser(scoring, 3);
+  std::stringstream out;
+  analyser.run(in, out);
+
+  std::set<long> indices;
+  std::string line;
+  while (std::getline(out, line))
+  {
+    std::stringstream ss(line);
+    long index;
+    std::string kind;
+    ss >> index >> kind;
+    indices.insert(index);
+
+    if (index == 11)
+      EXPECT_EQ(kind, "error");
+    else
+    {
+      EXPECT_EQ(kind, "move");
+      EXPECT_NE(line.find(" depth 4 "), std::string::npos) << line;
+    }
+  }
+  EXPECT_EQ(indices.size(), 10u);
+}
+
+TEST(server, tableSizeFromMemoryBudget)
+{
+  EXPECT_EQ(serverTableSize(128l << 20, 1), 1l << 24);
+  EXPECT_EQ(serverTableSize(128l << 20, 3), 1l << 22);
+  EXPECT_EQ(serverTableSize(0, 8), SERVER_MIN_TABLE_SIZE);
+}
+
+TEST(server, answersEachGame)
+{
+  const std::string anySubBoard = "-1,-1,-1,-1,-1,-1,-1,-1,-1";
+  std::stringstream in;
+  in << "a settings your_botid 0" << std::endl
+     << "b settings your_botid 1" << std::endl
+     << "a update game field " << EMPTY_FIELD << std::endl
+     << "b update game field " << EMPTY_FIELD << std::endl
+     << "a update game macroboard " << anySubBoard << std::endl
+     << "b update game macroboard 0,0,0,0,-1,0,0,0,0" << std::endl
+     << "c settings your_botid 0" << std::endl // a third game is one too many
+     << "b action move 500" << std::endl
+     << "a action move 500" << std::endl
+     << "a end" << std::endl
+     << "c update game field " << EMPTY_FIELD << std::endl
+     << "c update game macroboard " << anySubBoard << std::endl
+     << "c action move 500" << std::endl;
+
+  const Scoring scoring;
+  GameServer server(scoring, 2, 1 << 20, 2);
+  std::stringstream out;
+  server.run(in, out);
+
+  std::map<std::string, std::vector<std::string>> answers;
+  std::string line;
+  while (std::getline(out, line))
+  {
+    std::stringstream ss(line);
+    std::string id, kind;
+    ss >> id >> kind;
+    answers[id].push_back(kind);
+
+    if (kind == "place_move")
+    {
+      int x, y;
+      ss >> x >> y;
+      const Move moveGenerator = (id == "b") ? Move(0, 0, 1, 1) : Move::any;
+      EXPECT_TRUE(Board().isValidMove(moveGenerator, Move(y/3, x/3, y%3, x%3))) << line;
+    }
+  }
+
+  EXPECT_EQ(answers["a"], std::vector<std::string>({"place_move"}));
+  EXPECT_EQ(answers["b"], std::vector<std::string>({"place_move"}));
+  EXPECT_EQ(answers["c"], std::vector<std::string>({"error", "place_move"}));
+}
+
+TEST(analysis, multiPvLinesAndPrincipalVariation)
+{
+  const Scoring scoring;
+  std::stringstream out;
+  AnalysisSession session(scoring, out);
+
+  session.command("position startpos");
+  session.command("multipv 3");
+  session.command("go depth 4");
+  session.wait();
+
+  std::set<std::string> firstMoves;
+  int infoLines = 0;
+  std::string bestMove;
+  std::string line;
+  while (std::getline(out, line))
+  {
+    std::stringstream ss(line);
+    std::string kind;
+    ss >> kind;
+    if (kind == "bestmove")
+      ss >> bestMove;
+    else if (kind == "info" && line.find("info depth 4 ") == 0)
+    {
+      infoLines++;
+      const auto pv = line.substr(line.find(" pv ") + 4);
+      firstMoves.insert(pv.substr(0, pv.find(' ')));
+      if (line.find("multipv 1 ") != std::string::npos)
+      {
+        EXPECT_EQ(std::count(pv.begin(), pv.end(), ','), 4) << line; // fresh table, the PV is complete
+      }
+    }
+  }
+
+  EXPECT_EQ(infoLines, 3);
+  EXPECT_EQ(firstMoves.size(), 3u);
+  EXPECT_TRUE(firstMoves.count(bestMove)) << bestMove;
+}
+
+TEST(analysis, stopEndsInfiniteSearch)
+{
+  const Scoring scoring;
+  std::stringstream out;
+  AnalysisSession session(scoring, out);
+
+  session.command("position startpos");
+  session.command("go infinite");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const auto start = std::chrono::steady_clock::now();
+  session.command("stop");
+  const auto stopLatency = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(stopLatency, std::chrono::milliseconds(100));
+
+  const std::string output = out.str();
+  EXPECT_NE(output.find("info depth 1 "), std::string::npos);
+  EXPECT_NE(output.find("bestmove "), std::string::npos);
+  EXPECT_EQ(output.find("bestmove none"), std::string::npos);
+}
+
+TEST(tournament, eloAndSprt)
+{
+  TournamentScore even;
+  even.wins = 40;
+  even.draws = 20;
+  even.losses = 40;
+  EXPECT_NEAR(even.elo(), 0, 1e-9);
+  EXPECT_LT(even.llr(0, 10), 0);
+  EXPECT_GT(even.llr(-10, 0), 0);
+
+  TournamentScore better;
+  better.wins = 60;
+  better.draws = 20;
+  better.losses = 20;
+  EXPECT_NEAR(TournamentScore::eloToScore(better.elo()), better.score(), 1e-9);
+  EXPECT_GT(better.eloMargin(), 0);
+  EXPECT_GT(better.llr(0, 10), 0);
+
+  TournamentSettings settings;
+  settings.sprt = true;
+  settings.elo1 = 50;
+  const Tournament tournament(nullptr, nullptr, settings);
+  EXPECT_EQ(tournament.sprtDecision(better), 1);
+  EXPECT_EQ(tournament.sprtDecision(TournamentScore()), 0);
+}
+
+TEST(tournament, playsEveryGame)
+{
+  const Scoring scoring;
+  TournamentSettings settings;
+  settings.limits.depth = 3;
+  settings.maxGames = 6;
+  settings.nbWorkers = 2;
+
+  Tournament tournament(
+    [&scoring]() { return std::unique_ptr<TournamentPlayer>(new MinMaxPlayer<>(scoring)); },
+    []() { return std::unique_ptr<TournamentPlayer>(new RandomPlayer()); },
+    settings);
+  std::stringstream out;
+  const TournamentScore score = tournament.run(out);
+
+  EXPECT_EQ(score.games(), 6);
+  EXPECT_EQ(score.timeLosses, 0);
+  EXPECT_GT(score.wins, score.losses);
+  EXPECT_NE(out.str().find("games 6: "), std::string::npos);
+}
+
+TEST(selfplay, recordsReplayToTheirResult)
+{
+  const Scoring scoring;
+  SelfplaySettings settings;
+  settings.nbGames = 5;
+  settings.nbWorkers = 2;
+  settings.depth = 2;
+
+  std::stringstream file;
+  long nbPositions;
+  {
+    GameRecordWriter writer(file);
+    nbPositions = Selfplay(scoring, settings).run(writer);
+  }
+
+  GameRecordReader reader(file);
+  ASSERT_TRUE(reader.isValid());
+
+  long nbGames = 0;
+  long nbRead = 0;
+  GameRecord record;
+  while (reader.next(record))
+  {
+    nbGames++;
+    nbRead += record.nbMoves - record.nbRandom;
+    EXPECT_EQ(record.nbRandom, settings.randomPlies);
+
+    Board board;
+    Move moveGenerator = Move::any;
+    player_t player = Owner::Player0;
+    std::array<MoveValued, 9*9+1> moves;
+    for (int i = 0; i < record.nbMoves; i++)
+    {
+      ASSERT_EQ(board.winner(), Owner::None);
+      board.possibleMoves(moves, moveGenerator);
+      const Move move = record.move(i);
+      EXPECT_TRUE(std::any_of(moves.begin(), moves.end(), [&](const MoveValued& mv) { return mv.move == move; }));
+
+      board.action(move, player);
+      moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+      player = OTHER(player);
+    }
+    EXPECT_EQ(board.winner(), record.winner);
+  }
+
+  EXPECT_TRUE(reader.isValid());
+  EXPECT_EQ(nbGames, settings.nbGames);
+  EXPECT_EQ(nbRead, nbPositions);
+}
+
+TEST(selfplay, dumpedFieldsAreTheNetworkFeatures)
+{
+  NnueNetwork network;
+  randomNetwork(network, 2);
+  Accumulator accumulator;
+  accumulator.use(network.features);
+
+  const Scoring scoring;
+  SelfplaySettings settings;
+  settings.nbGames = 5;
+  settings.nbWorkers = 1;
+  settings.depth = 2;
+
+  std::stringstream file;
+  {
+    GameRecordWriter writer(file);
+    Selfplay(scoring, settings).run(writer);
+  }
+
+  GameRecordReader reader(file);
+  ASSERT_TRUE(reader.isValid());
+
+  long nbCompleted = 0; // sub-boards, over all the positions
+  GameRecord record;
+  while (reader.next(record))
+  {
+    Board board;
+    player_t player = Owner::Player0;
+    int ply = record.nbRandom;
+    for (int i = 0; i < record.nbRandom; i++)
+    {
+      board.action(record.move(i), player);
+      player = OTHER(player);
+    }
+
+    forEachPosition(record, [&](const std::array<char, 9*9>& field, player_t, score_t)
+    {
+      accumulator.refresh(board.getBoard());
+      EXPECT_EQ(fieldFeatures(network.features, std::string(field.begin(), field.end())), accumulator.current());
+      for (int i = 0; i < 9; i++)
+        nbCompleted += board.isWonOrFull_d(i);
+
+      board.action(record.move(ply++), player);
+      player = OTHER(player);
+    });
+  }
+  EXPECT_GT(nbCompleted, 0);
+}
+
+TEST(selfplay, rejectsOtherFiles)
+{
+  std::stringstream file("UTTTNNUE and more");
+  GameRecordReader reader(file);
+  GameRecord record;
+  EXPECT_FALSE(reader.isValid());
+  EXPECT_FALSE(reader.next(record));
+}
+
+/// the hand-crafted sub-board scores, as Scoring computed them before they became ScoringParameters
+static score_t handCraftedScore(ttt_t ttt, Owner player)
+{
+  if (win(ttt, player)) return VICTORY_POINTS;
+  if (win(ttt, OTHER(player))) return 0;
+  if (!winnable(ttt, player)) return 0;
+
+  switch (number_of_ways_to_win(ttt, player))
+  {
+  case 5: return VICTORY_POINTS - 1;
+  case 4: return VICTORY_POINTS - 2;
+  case 3: return VICTORY_POINTS - 3;
+  case 2: return VICTORY_POINTS - 4;
+  case 1: return VICTORY_POINTS - 5;
+  }
+
+  switch (number_of_unique_threats(ttt, player))
+  {
+  case 4: return 6;
+  case 3: return 5;
+  case 2: return 4;
+  case 1: return 2;
+  default: return 1;
+  }
+}
+
+TEST(tuner, defaultParametersAreTheHandCraftedScores)
+{
+  const Scoring scoring;
+  long differences = 0;
+  for (ttt_t ttt = 0; ttt < NUMBER_OF_TTT; ttt++)
+  {
+    differences += scoring.score(ttt, Owner::Player0) != handCraftedScore(ttt, Owner::Player0);
+    differences += scoring.score(ttt, Owner::Player1) != handCraftedScore(ttt, Owner::Player1);
+  }
+  EXPECT_EQ(differences, 0);
+}
+
+TEST(tuner, parametersFileRoundTrip)
+{
+  const std::string path = testing::TempDir() + "scoring.params";
+  ScoringParameters parameters;
+  parameters.values[ScoringParameters::Threats0] = 3;
+  ASSERT_TRUE(parameters.save(path));
+
+  ScoringParameters loaded;
+  ASSERT_TRUE(loaded.load(path));
+  EXPECT_EQ(loaded.values, parameters.values);
+
+  std::ofstream(path) << "victory 16" << std::endl;
+  EXPECT_FALSE(loaded.load(path));
+}
+
+TEST(tuner, descentLowersTheError)
+{
+  const Scoring scoring;
+  SelfplaySettings settings;
+  settings.nbGames = 20;
+  settings.nbWorkers = 1;
+  settings.depth = 2;
+
+  std::stringstream file;
+  {
+    GameRecordWriter writer(file);
+    Selfplay(scoring, settings).run(writer);
+  }
+  GameRecordReader reader(file);
+  std::vector<TunerPosition> positions;
+  ScoringTuner::load(reader, positions);
+  ASSERT_FALSE(positions.empty());
+
+  ScoringTuner tuner(positions, 2);
+  const ScoringParameters defaults;
+  tuner.fitScale(defaults);
+  const double before = tuner.error(defaults);
+
+  std::stringstream log;
+  const ScoringParameters tuned = tuner.tune(defaults, 2, log);
+  EXPECT_LE(tuner.error(tuned), before);
+  for (score_t value : tuned.values)
+  {
+    EXPECT_GE(value, 0);
+    EXPECT_LE(value, MAX_SCORING_PARAMETER);
+  }
+}
+
+TEST(bench, nodeCountIsReproducible)
+{
+  const Scoring scoring;
+  std::stringstream out;
+
+  seedHashers(BENCH_SEED);
+  std::unique_ptr<MinMaxBasedAI<1 << 16>> first(new MinMaxBasedAI<1 << 16>(scoring));
+  first->setVerbose(false);
+  const BenchResult firstResult = runBench(*first, -4, out);
+
+  seedHashers(BENCH_SEED);
+  std::unique_ptr<MinMaxBasedAI<1 << 16>> second(new MinMaxBasedAI<1 << 16>(scoring));
+  second->setVerbose(false);
+  const BenchResult secondResult = runBench(*second, -4, out);
+
+  EXPECT_GT(firstResult.nodes, 0);
+  EXPECT_EQ(firstResult.nodes, secondResult.nodes);
+}
+
+TEST(telemetry, lineForEachDepthAndMove)
+{
+  const std::string path = testing::TempDir() + "telemetry.jsonl";
+  std::remove(path.c_str());
+
+  const Scoring scoring;
+  TelemetrySink sink;
+  ASSERT_TRUE(sink.open(path));
+  std::unique_ptr<MinMaxBasedAI<1 << 16>> ai(new MinMaxBasedAI<1 << 16>(scoring));
+  ai->setVerbose(false);
+  ai->setTelemetry(&sink);
+
+  Board board;
+  ai->analyse(board, Owner::Player0, Move::any, std::numeric_limits<double>::infinity(), 3);
+
+  std::ifstream in(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(in, line))
+    lines.push_back(line);
+
+  ASSERT_EQ(lines.size(), 4u);
+  for (int depth = 1; depth <= 3; depth++)
+    EXPECT_EQ(lines[depth-1].find("{\"event\":\"depth\",\"depth\":" + std::to_string(depth) + ","), 0u) << lines[depth-1];
+  EXPECT_EQ(lines[3].find("{\"event\":\"move\",\"depth\":3,"), 0u) << lines[3];
+  EXPECT_NE(lines[3].find("\"budget_ms\":null"), std::string::npos);
+  EXPECT_NE(lines[3].find("\"abort\":\"depth_limit\""), std::string::npos);
+}
+
+/// alpha-beta without table nor ordering, the value from the point of view of player
+static score_t referenceNegamax(Board& board, const Scoring& scoring, const Move& moveGenerator, player_t player, int depth, score_t A, score_t B)
+{
+  if (board.winner() != Owner::None || depth == 0)
+  {
+    const score_t score = scoring.score(board);
+    return isDraw(score) ? score : ((player == Owner::Player0) ? 1 : -1) * score;
+  }
+
+  std::array<MoveValued, 9*9+1> moves;
+  board.possibleMoves(moves, moveGenerator);
+  score_t best = -GLOBAL_VICTORY0_SCORE-1;
+  for (int i = 0; moves[i].move != Move::end; i++)
+  {
+    board.action(moves[i].move, player);
+    const Move next = board.isWonOrFull_d(moves[i].move.yx()) ? Move::any : moves[i].move;
+    score_t value = referenceNegamax(board, scoring, next, OTHER(player), depth-1, -B, -A);
+    board.cancel();
+
+    if (!isDraw(value))
+      value = -value;
+    if (decodeDraw(value) > decodeDraw(best))
+    {
+      best = value;
+      if (decodeDraw(best) > decodeDraw(A))
+        A = best;
+      if (decodeDraw(A) >= decodeDraw(B))
+        break;
+    }
+  }
+  return best;
+}
+
+TEST(minmax, tableCutoffsKeepTheValue)
+{
+  const Scoring scoring;
+  std::unique_ptr<MinMaxBasedAI<1 << 16>> ai(new MinMaxBasedAI<1 << 16>(scoring));
+  ai->setVerbose(false);
+  std::mt19937 rng(0);
+
+  // positions of random games, searched deep enough for transposition cutoffs on children (ETC_MIN_DEPTH)
+  const int depth = 8;
+  for (int game = 0; game < 20; game++)
+  {
+    Board board;
+    Move moveGenerator = Move::any;
+    player_t player = Owner::Player0;
+    std::array<MoveValued, 9*9+1> moves;
+    for (int ply = 0; ply < 10 + game && board.winner() == Owner::None; ply++)
+    {
+      board.possibleMoves(moves, moveGenerator);
+      int nbMoves = 0;
+      while (moves[nbMoves].move != Move::end)
+        nbMoves++;
+      const Move move = moves[std::uniform_int_distribution<int>(0, nbMoves - 1)(rng)].move;
+      board.action(move, player);
+      moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+      player = OTHER(player);
+    }
+    if (board.winner() != Owner::None)
+      continue;
+
+    const SearchResult result = ai->analyse(board, player, moveGenerator, std::numeric_limits<double>::infinity(), depth);
+    const score_t expected = referenceNegamax(board, scoring, moveGenerator, player, result.depth, MIN_NEGATABLE_SCORE, MAX_NEGATABLE_SCORE);
+    EXPECT_EQ(decodeDraw(result.best.value), decodeDraw(expected)) << "game " << game;
+  }
+}
+
+TEST(minmax, earlyDrawIsSearchedAtTheRootOnly)
+{
+  const Scoring scoring;
+  std::unique_ptr<MinMaxBasedAI<1 << 16>> ai(new MinMaxBasedAI<1 << 16>(scoring));
+  ai->setVerbose(false);
+
+  // the only move that does not lose draws at once
+  Board board(almostDeadField);
+  const SearchResult blocking = ai->analyse(board, Owner::Player1, Move(0, 0, 2, 2), std::numeric_limits<double>::infinity(), 4);
+  EXPECT_EQ(blocking.best.move, Move(2, 2, 0, 2));
+  EXPECT_TRUE(isDraw(blocking.best.value));
+
+  // the game goes on, with a move to play
+  board.action(Move(2, 2, 0, 2), Owner::Player1);
+  const SearchResult drawn = ai->analyse(board, Owner::Player0, Move::any, std::numeric_limits<double>::infinity(), 4);
+  EXPECT_TRUE(board.isValidMove(Move::any, drawn.best.move));
+  EXPECT_TRUE(isDraw(drawn.best.value));
+  EXPECT_EQ(drawn.depth, 1);
+}
+
+TEST(probcut, calibrationFitsTheDeepScores)
+{
+  ProbCutCalibration calibration;
+  for (int shallow = -500; shallow <= 500; shallow += 10)
+  {
+    calibration.add(shallow, 2*shallow + 100 + 30);
+    calibration.add(shallow, 2*shallow + 100 - 30);
+  }
+
+  ProbCutParameters fitted;
+  ASSERT_TRUE(calibration.fit(fitted));
+  EXPECT_NEAR(fitted.slope, 2, 1e-9);
+  EXPECT_NEAR(fitted.intercept, 100, 1e-9);
+  EXPECT_NEAR(fitted.sigma, 30, 1e-9);
+
+  // 1.5 sigmas of margin: a deep score of at least 400 is predicted from a shallow one of 172.5
+  EXPECT_EQ(fitted.shallowBound(400, 1), 173);
+  EXPECT_EQ(fitted.shallowBound(400, -1), 127);
+
+  const std::string path = testing::TempDir() + "probcut.params";
+  ASSERT_TRUE(fitted.save(path));
+  ProbCutParameters loaded;
+  EXPECT_FALSE(loaded.enabled);
+  ASSERT_TRUE(loaded.load(path));
+  EXPECT_TRUE(loaded.enabled);
+  EXPECT_NEAR(loaded.slope, fitted.slope, 1e-3);
+  EXPECT_NEAR(loaded.sigma, fitted.sigma, 1e-3);
+}
+
+/// fixed depth search of the bench (reproducible hashes, no time limit)
+static SearchResult probCutSearch(const Board& position, player_t player, const Move& moveGenerator, int depth, const ProbCutParameters& parameters)
+{
+  seedHashers(BENCH_SEED);
+  const Scoring scoring;
+  std::unique_ptr<MinMaxBasedAI<1 << 18>> ai(new MinMaxBasedAI<1 << 18>(scoring));
+  ai->setVerbose(false);
+  ai->setProbCut(parameters);
+
+  Board board(position);
+  return ai->analyse(board, player, moveGenerator, std::numeric_limits<double>::infinity(), depth);
+}
+
+TEST(probcut, searchIsOffInTheEndgame)
+{
+  // a narrow margin, so that cuts happen wherever ProbCut is on
+  const std::string path = testing::TempDir() + "probcut.params";
+  std::ofstream(path) << "slope 1\nintercept 0\nsigma 20\nthreshold 1" << std::endl;
+  ProbCutParameters parameters;
+  ASSERT_TRUE(parameters.load(path));
+  const ProbCutParameters off;
+  const int depth = PROBCUT_MIN_DEPTH + 2;
+
+  // a game played until the endgame
+  Board board;
+  Move moveGenerator = Move::any;
+  player_t player = Owner::Player0;
+  for (int ply = 0; board.nonesSum() >= PROBCUT_MIN_NONES; ++ply)
+  {
+    ASSERT_EQ(board.winner(), Owner::None);
+    if (ply == 30)
+    {
+      // midgame: ProbCut cuts nodes, the value stays a heuristic score
+      const SearchResult with = probCutSearch(board, player, moveGenerator, depth, parameters);
+      const SearchResult without = probCutSearch(board, player, moveGenerator, depth, off);
+      EXPECT_NE(with.positions, without.positions);
+      EXPECT_LE(std::abs(decodeDraw(with.best.value)), PROBCUT_MAX_BOUND);
+      EXPECT_LE(std::abs(decodeDraw(with.best.value) - decodeDraw(without.best.value)), 4*parameters.sigma);
+    }
+
+    std::array<MoveValued, 9*9+1> moves;
+    board.possibleMoves(moves, moveGenerator);
+    int nbMoves = 0;
+    while (moves[nbMoves].move != Move::end)
+      nbMoves++;
+
+    const Move move = moves[(7 * ply) % nbMoves].move;
+    board.action(move, player);
+    moveGenerator = board.isWonOrFull_d(move.yx()) ? Move::any : move;
+    player = OTHER(player);
+  }
+  ASSERT_EQ(board.winner(), Owner::None);
+
+  // endgame: the same search with and without ProbCut
+  const SearchResult with = probCutSearch(board, player, moveGenerator, depth, parameters);
+  const SearchResult without = probCutSearch(board, player, moveGenerator, depth, off);
+  EXPECT_EQ(with.best.value, without.best.value);
+  EXPECT_EQ(with.positions, without.positions);
+}
@@ -0,0 +1,52 @@
+"""Checks the inputs train_nnue.py builds, run with `python3 test/test_train_nnue.py`.
+
+The fields are the ones of the nnue.normalizedFieldIsTheBoardFeatures test of test.cpp, which checks that
+NORMALIZED_FIELD gives the features of Accumulator::refresh on the Board of RAW_FIELD.
+"""
+import os
+import sys
+import unittest
+import numpy
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import train_nnue
+
+# a won (top left) and a drawn (top middle) sub-board
+RAW_FIELD = (
+		'000010...'
+		'1.1011...'
+		'...101...'
+		'...1.....'
+		'....0....'
+		'.........'
+		'.........'
+		'.........'
+		'.........'
+)
+NORMALIZED_FIELD = (
+		'000010...'
+		'000011...'
+		'000100...'
+		'...1.....'
+		'....0....'
+		'.........'
+		'.........'
+		'.........'
+		'.........'
+)
+
+class FeaturesTest(unittest.TestCase):
+		def test_raw_field_is_normalized(self):
+				raw = train_nnue.features(','.join(RAW_FIELD))
+				normalized = train_nnue.features(','.join(NORMALIZED_FIELD))
+				numpy.testing.assert_array_equal(raw, normalized)
+				self.assertEqual(raw.sum(), 9 + 9 + 2)
+
+		def test_open_sub_board_is_kept(self):
+				x = train_nnue.features(','.join(NORMALIZED_FIELD))
+				center = 4*9
+				self.assertEqual(x[train_nnue.feature_index(center + 0, '1')], 1)
+				self.assertEqual(x[train_nnue.feature_index(center + 4, '0')], 1)
+
+if __name__ == '__main__':
+		unittest.main()
@@ -0,0 +1,184 @@
+"""Trains the network evaluator of src/nnue.h on self-play positions.
+
+Each line of the positions file is a field (the 81 comma separated cells of the game engine,
+'.', '0' or '1') followed by the winner of the game it was taken from ('0', '1' or 'X' for a draw)
+and optionally by the score of a search of the position, from the point of view of Player0,
+as written by `main_selfplay --dump`.
+The completed sub-boards are normalized as in the engine (all the cells of the winner, or a fixed draw pattern),
+so raw fields give the inputs the network sees in a search.
+The network learns the probability that Player0 wins (the game result blended with the search score
+when there is one), and is written in the weights file format read by NnueNetwork::load.
+"""
+import argparse
+import struct
+import numpy
+
+parser = argparse.ArgumentParser()
+parser.add_argument('positions', help='self-play positions file')
+parser.add_argument('-o', '--output', default='networks/default.nnue', help='weights file to write')
+parser.add_argument('--epochs', type=int, default=30)
+parser.add_argument('--batch', type=int, default=1024)
+parser.add_argument('--lr', type=float, default=1e-3)
+parser.add_argument('--seed', type=int, default=0)
+parser.add_argument('--result-weight', type=float, default=0.0, help='weight of the game result against the search score')
+parser.add_argument('--score-scale', type=float, default=400, help='search score of a 73%% (logit 1.0) winning chance')
+
+# must match src/common/accumulator.h and src/nnue.h
+FEATURES = 2*9*9
+HIDDEN = 64
+HIDDEN2 = 32
+ACTIVATION_MAX = 127
+WEIGHT_SCALE = 1 << 6
+MAGIC = b'UTTTNNUE'
+VERSION = 1
+
+# largest float weights that still fit their quantized type
+MAX_FEATURE_WEIGHT = 2.0 # 81 active features must not overflow the int16 accumulator
+MAX_HIDDEN_WEIGHT = 127 / WEIGHT_SCALE # int8
+
+TARGETS = {'0': 1.0, 'X': 0.5, '1': 0.0}
+
+# normalize() of src/common/ttt_utils.h, the engine evaluates the completed sub-boards in this form
+LINES = [(0, 1, 2), (3, 4, 5), (6, 7, 8), (0, 3, 6), (1, 4, 7), (2, 5, 8), (0, 4, 8), (2, 4, 6)]
+DRAW_PATTERN = '010011100'
+
+def feature_index(cell, c):
+		"""cell is in the board order of src/common/board.h (sub-board index*9 + cell of the sub-board)"""
+		return 2*cell + (0 if c == '0' else 1)
+
+def normalize(cells):
+		"""cells are the 9 cells of a sub-board, won ones become all the cells of the winner and drawn ones DRAW_PATTERN"""
+		for player in '01':
+				if any(all(cells[i] == player for i in line) for line in LINES):
+						return player*9
+		if '.' not in cells:
+				return DRAW_PATTERN
+		return cells
+
+def features(field):
+		"""field is the 81 comma separated cells of the riddles protocol, raw or already normalized"""
+		cells = field.split(',')
+		x = numpy.zeros(FEATURES, dtype=numpy.uint8)
+		for index in range(9):
+				row, col = index // 3 * 3, index % 3 * 3
+				sub = normalize(''.join(cells[(row + i // 3)*9 + col + i % 3] for i in range(9)))
+				for i, c in enumerate(sub):
+						if c != '.':
+								x[feature_index(index*9 + i, c)] = 1
+		return x
+
+def read_positions(path):
+		inputs = []
+		targets = []
+		with open(path) as f:
+				for line in f:
+						field, winner, *score = line.split()
+						inputs.append(features(field))
+
+						target = TARGETS[winner]
+						if score:
+								searched = 1/(1 + numpy.exp(-float(score[0]) / args.score_scale))
+								target = args.result_weight*target + (1 - args.result_weight)*searched
+						targets.append(target)
+		return numpy.array(inputs), numpy.array(targets, dtype=numpy.float32)
+
+class Network:
+		def __init__(self, rng):
+				self.params = {
+						'w1': rng.normal(0, 1/numpy.sqrt(16), (FEATURES, HIDDEN)).astype(numpy.float32),
+						'b1': numpy.full(HIDDEN, 0.5, dtype=numpy.float32),
+						'w2': rng.normal(0, 1/numpy.sqrt(HIDDEN), (HIDDEN, HIDDEN2)).astype(numpy.float32),
+						'b2': numpy.full(HIDDEN2, 0.5, dtype=numpy.float32),
+						'w3': rng.normal(0, 1/numpy.sqrt(HIDDEN2), HIDDEN2).astype(numpy.float32),
+						'b3': numpy.zeros(1, dtype=numpy.float32),
+				}
+				self.m = {k: numpy.zeros_like(v) for k, v in self.params.items()}
+				self.v = {k: numpy.zeros_like(v) for k, v in self.params.items()}
+				self.t = 0
+
+		def forward(self, x):
+				p = self.params
+				z1 = x @ p['w1'] + p['b1']
+				h1 = numpy.clip(z1, 0, 1)
+				z2 = h1 @ p['w2'] + p['b2']
+				h2 = numpy.clip(z2, 0, 1)
+				out = h2 @ p['w3'] + p['b3']
+				return out, (x, z1, h1, z2, h2)
+
+		def loss(self, x, y):
+				out, _ = self.forward(x)
+				prob = 1/(1 + numpy.exp(-out))
+				eps = 1e-7
+				return -numpy.mean(y*numpy.log(prob + eps) + (1 - y)*numpy.log(1 - prob + eps))
+
+		def step(self, x, y, lr):
+				p = self.params
+				out, (x, z1, h1, z2, h2) = self.forward(x)
+				prob = 1/(1 + numpy.exp(-out))
+
+				# binary cross-entropy on the sigmoid of the output
+				dout = (prob - y) / len(y)
+				dh2 = numpy.outer(dout, p['w3']) * ((z2 > 0) & (z2 < 1))
+				dh1 = (dh2 @ p['w2'].T) * ((z1 > 0) & (z1 < 1))
+				grads = {
+						'w3': h2.T @ dout,
+						'b3': numpy.array([dout.sum()]),
+						'w2': h1.T @ dh2,
+						'b2': dh2.sum(axis=0),
+						'w1': x.T @ dh1,
+						'b1': dh1.sum(axis=0),
+				}
+
+				# adam
+				self.t += 1
+				for k, g in grads.items():
+						self.m[k] = 0.9*self.m[k] + 0.1*g
+						self.v[k] = 0.999*self.v[k] + 0.001*g*g
+						m = self.m[k] / (1 - 0.9**self.t)
+						v = self.v[k] / (1 - 0.999**self.t)
+						p[k] -= lr * m / (numpy.sqrt(v) + 1e-8)
+
+				numpy.clip(p['w1'], -MAX_FEATURE_WEIGHT, MAX_FEATURE_WEIGHT, out=p['w1'])
+				numpy.clip(p['w2'], -MAX_HIDDEN_WEIGHT, MAX_HIDDEN_WEIGHT, out=p['w2'])
+
+		def save(self, path):
+				p = self.params
+				def quantize(a, scale, dtype):
+						info = numpy.iinfo(dtype)
+						return numpy.clip(numpy.round(a * scale), info.min, info.max).astype(dtype)
+
+				with open(path, 'wb') as f:
+						f.write(MAGIC)
+						f.write(struct.pack('<4I', VERSION, FEATURES, HIDDEN, HIDDEN2))
+						f.write(quantize(p['b1'], ACTIVATION_MAX, '<i2').tobytes())
+						f.write(quantize(p['w1'], ACTIVATION_MAX, '<i2').tobytes())
+						f.write(quantize(p['w2'].T, WEIGHT_SCALE, 'i1').tobytes())
+						f.write(quantize(p['b2'], ACTIVATION_MAX*WEIGHT_SCALE, '<i4').tobytes())
+						f.write(quantize(p['w3'], WEIGHT_SCALE, '<i2').tobytes())
+						f.write(quantize(p['b3'], ACTIVATION_MAX*WEIGHT_SCALE, '<i4').tobytes())
+
+def main():
+		rng = numpy.random.default_rng(args.seed)
+		inputs, targets = read_positions(args.positions)
+		print('{} positions, Player0 score {:.3f}'.format(len(targets), targets.mean()), flush=True)
+
+		order = rng.permutation(len(targets))
+		validation = order[:len(order)//20]
+		training = order[len(order)//20:]
+
+		network = Network(rng)
+		for epoch in range(args.epochs):
+				rng.shuffle(training)
+				for start in range(0, len(training), args.batch):
+						batch = training[start:start + args.batch]
+						network.step(inputs[batch].astype(numpy.float32), targets[batch], args.lr)
+
+				loss = network.loss(inputs[validation].astype(numpy.float32), targets[validation])
+				print('epoch {}: validation loss {:.4f}'.format(epoch + 1, loss), flush=True)
+
+		network.save(args.output)
+		print('weights written to', args.output)
+
+if __name__ == '__main__':
+		args = parser.parse_args()
+		main()